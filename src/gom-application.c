@@ -38,6 +38,9 @@ struct _GomApplication
   GQueue *queue;
   GType miner_type;
   gboolean refreshing;
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  GMemoryMonitor *memory_monitor;
+#endif
 };
 
 struct _GomApplicationClass
@@ -64,7 +67,7 @@ gom_application_insert_shared_content_cb (GObject *source,
   GDBusMethodInvocation *invocation = G_DBUS_METHOD_INVOCATION (user_data);
   GError *error;
 
-  self = GOM_APPLICATION (g_application_get_default ());
+  self = GOM_APPLICATION (g_object_get_data (G_OBJECT (invocation), "application"));
   g_application_release (G_APPLICATION (self));
 
   error = NULL;
@@ -89,6 +92,8 @@ gom_application_insert_shared_content (GomApplication *self,
                                        const gchar *shared_type,
                                        const gchar *source_urn)
 {
+  /* several applications can share a process, see gom-miner-host.c */
+  g_object_set_data (G_OBJECT (invocation), "application", self);
   g_application_hold (G_APPLICATION (self));
   gom_miner_insert_shared_content_async (self->miner,
                                          account_id,
@@ -101,6 +106,47 @@ gom_application_insert_shared_content (GomApplication *self,
   return TRUE;
 }
 
+static void
+gom_application_insert_shared_content_batch_cb (GObject *source,
+                                                GAsyncResult *res,
+                                                gpointer user_data)
+{
+  GomApplication *self;
+  GDBusMethodInvocation *invocation = G_DBUS_METHOD_INVOCATION (user_data);
+  GError *error;
+
+  self = GOM_APPLICATION (g_object_get_data (G_OBJECT (invocation), "application"));
+  g_application_release (G_APPLICATION (self));
+
+  error = NULL;
+  if (!gom_miner_insert_shared_content_batch_finish (GOM_MINER (source), res, &error))
+    {
+      g_printerr ("Failed to insert shared content: %s\n", error->message);
+      g_dbus_method_invocation_take_error (invocation, error);
+      goto out;
+    }
+
+  gom_dbus_complete_insert_shared_content_batch (self->skeleton, invocation);
+
+ out:
+  g_object_unref (invocation);
+}
+
+static gboolean
+gom_application_insert_shared_content_batch (GomApplication *self,
+                                             GDBusMethodInvocation *invocation,
+                                             GVariant *items)
+{
+  g_object_set_data (G_OBJECT (invocation), "application", self);
+  g_application_hold (G_APPLICATION (self));
+  gom_miner_insert_shared_content_batch_async (self->miner,
+                                               items,
+                                               self->cancellable,
+                                               gom_application_insert_shared_content_batch_cb,
+                                               g_object_ref (invocation));
+  return TRUE;
+}
+
 static void
 gom_application_process_queue (GomApplication *self)
 {
@@ -128,6 +174,16 @@ gom_application_process_queue (GomApplication *self)
   g_clear_object (&invocation);
 }
 
+static void
+gom_application_update_metrics (GomApplication *self)
+{
+  GVariant *metrics;
+
+  metrics = gom_miner_dup_metrics (self->miner);
+  gom_dbus_set_metrics (self->skeleton, metrics);
+  g_variant_unref (metrics);
+}
+
 static void
 gom_application_refresh_db_cb (GObject *source,
                                GAsyncResult *res,
@@ -137,10 +193,13 @@ gom_application_refresh_db_cb (GObject *source,
   GDBusMethodInvocation *invocation = user_data;
   GError *error = NULL;
 
-  self = GOM_APPLICATION (g_application_get_default ());
+  self = GOM_APPLICATION (g_object_get_data (G_OBJECT (invocation), "application"));
   g_application_release (G_APPLICATION (self));
   self->refreshing = FALSE;
 
+  /* those of the refresh as a whole */
+  gom_application_update_metrics (self);
+
   gom_miner_refresh_db_finish (GOM_MINER (source), res, &error);
   if (error != NULL)
     {
@@ -165,6 +224,7 @@ gom_application_refresh_db (GomApplication *self,
 
   index_types = g_strdupv ((gchar **) arg_index_types);
   g_object_set_data_full (G_OBJECT (invocation), "index-types", index_types, (GDestroyNotify) g_strfreev);
+  g_object_set_data (G_OBJECT (invocation), "application", self);
   g_queue_push_tail (self->queue, g_object_ref (invocation));
   gom_application_process_queue (self);
   return TRUE;
@@ -224,17 +284,95 @@ gom_application_shutdown (GApplication *application)
   G_APPLICATION_CLASS (gom_application_parent_class)->shutdown (application);
 }
 
+static void
+gom_application_display_name_cb (GomApplication *self)
+{
+  const gchar *display_name;
+
+  display_name = gom_miner_get_display_name (self->miner);
+  gom_dbus_set_display_name (self->skeleton, display_name);
+}
+
+static void
+gom_application_phase_changed_cb (GomApplication *self,
+                                  const gchar *account_id,
+                                  const gchar *phase)
+{
+  GVariant *phases;
+
+  phases = gom_miner_dup_phases (self->miner);
+  gom_dbus_set_phases (self->skeleton, phases);
+  g_variant_unref (phases);
+
+  gom_dbus_emit_phase_changed (self->skeleton, account_id, phase);
+}
+
+static void
+gom_application_account_refreshed_cb (GomApplication *self,
+                                      const gchar *account_id,
+                                      GVariant *metrics)
+{
+  gom_application_update_metrics (self);
+  gom_dbus_emit_account_refreshed (self->skeleton, account_id, metrics);
+}
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+static void
+gom_application_low_memory_warning_cb (GomApplication *self,
+                                       GMemoryMonitorWarningLevel level)
+{
+  /* everything cached can be fetched again on the next refresh */
+  g_debug ("Low memory warning (level %d), dropping caches", (gint) level);
+  gom_miner_drop_caches (self->miner);
+}
+#endif
+
 static void
 gom_application_constructed (GObject *object)
 {
   GomApplication *self = GOM_APPLICATION (object);
-  const gchar *display_name;
+  GVariant *phases;
 
   G_OBJECT_CLASS (gom_application_parent_class)->constructed (object);
 
+  /* the display name is only known once the miner has its GoaClient */
   self->miner = g_object_new (self->miner_type, NULL);
-  display_name = gom_miner_get_display_name (self->miner);
-  gom_dbus_set_display_name (self->skeleton, display_name);
+  g_signal_connect_object (self->miner,
+                           "notify::display-name",
+                           G_CALLBACK (gom_application_display_name_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+  gom_application_display_name_cb (self);
+
+  g_signal_connect_object (self->miner,
+                           "phase-changed",
+                           G_CALLBACK (gom_application_phase_changed_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->miner,
+                           "account-refreshed",
+                           G_CALLBACK (gom_application_account_refreshed_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  phases = gom_miner_dup_phases (self->miner);
+  gom_dbus_set_phases (self->skeleton, phases);
+  g_variant_unref (phases);
+
+  gom_application_update_metrics (self);
+
+  /* GMemoryMonitor is new in GLib 2.64: with an older one the caches
+   * are not dropped under memory pressure, and the URN cache is only
+   * bounded by its budget
+   */
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  self->memory_monitor = g_memory_monitor_dup_default ();
+  g_signal_connect_object (self->memory_monitor,
+                           "low-memory-warning",
+                           G_CALLBACK (gom_application_low_memory_warning_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+#endif
 }
 
 static void
@@ -243,6 +381,9 @@ gom_application_dispose (GObject *object)
   GomApplication *self = GOM_APPLICATION (object);
 
   g_clear_object (&self->cancellable);
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  g_clear_object (&self->memory_monitor);
+#endif
   g_clear_object (&self->miner);
   g_clear_object (&self->skeleton);
 
@@ -285,6 +426,10 @@ gom_application_init (GomApplication *self)
                             "handle-insert-shared-content",
                             G_CALLBACK (gom_application_insert_shared_content),
                             self);
+  g_signal_connect_swapped (self->skeleton,
+                            "handle-insert-shared-content-batch",
+                            G_CALLBACK (gom_application_insert_shared_content_batch),
+                            self);
   g_signal_connect_swapped (self->skeleton, "handle-refresh-db", G_CALLBACK (gom_application_refresh_db), self);
 
   self->queue = g_queue_new ();
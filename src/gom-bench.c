@@ -0,0 +1,707 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+/* Runs the miner core against a private tracker database and a
+ * synthetic provider, and reports how long an initial import, a refresh
+ * without changes, a refresh with some changes and one migrating to a
+ * new version take; it fails if the migration did not work. The accounts
+ * are served by a fake org.gnome.OnlineAccounts, so it has to run on a
+ * session bus of its own, e.g. with dbus-run-session.
+ */
+
+#include "config.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <goa/goa.h>
+
+#include "gom-miner.h"
+#include "gom-tracker.h"
+#include "gom-utils.h"
+
+#define GOM_TYPE_BENCH_MINER (gom_bench_miner_get_type ())
+
+typedef struct {
+  GomMiner parent;
+} GomBenchMiner;
+
+typedef struct {
+  GomMinerClass parent_class;
+} GomBenchMinerClass;
+
+GType gom_bench_miner_get_type (void);
+
+G_DEFINE_TYPE (GomBenchMiner, gom_bench_miner, GOM_TYPE_MINER)
+
+static const gint64 BENCH_BASE_MTIME = 1262304000;
+
+#define BENCH_MINER_IDENTIFIER "gd:bench:miner:00000000-0000-0000-0000-000000000000"
+#define BENCH_LEGACY_CONTACT "urn:bench:legacy-contact"
+
+/* the same step as the real miners, run by the last scenario */
+static const GomMinerMigration migrations[] = {
+  { 2, GOM_MINER_MIGRATION_CONTACTS_INTO_GRAPH, TRUE },
+  { 0, }
+};
+
+static gint n_accounts = 1;
+static gint n_authors = 200;
+static gint n_documents = 10000;
+static gint n_folders = 500;
+static gint n_photos = 10000;
+static gdouble changed_percent = 10.0;
+static gchar *store_path = NULL;
+
+/* entries whose modification time moved since the initial import */
+static guint generation;
+
+static GOptionEntry entries[] = {
+  { "accounts", 0, 0, G_OPTION_ARG_INT, &n_accounts, "Number of accounts", "N" },
+  { "authors", 0, 0, G_OPTION_ARG_INT, &n_authors, "Number of distinct authors", "N" },
+  { "documents", 0, 0, G_OPTION_ARG_INT, &n_documents, "Documents per account", "N" },
+  { "folders", 0, 0, G_OPTION_ARG_INT, &n_folders, "Folders per account", "N" },
+  { "photos", 0, 0, G_OPTION_ARG_INT, &n_photos, "Photos per account", "N" },
+  { "changed", 0, 0, G_OPTION_ARG_DOUBLE, &changed_percent, "Percentage of entries changed by the last refresh", "PERCENT" },
+  { "store", 0, 0, G_OPTION_ARG_FILENAME, &store_path, "Directory of the tracker database (default: a temporary one)", "DIR" },
+  { NULL }
+};
+
+typedef struct {
+  guint n_seen;
+  guint n_changed;
+  guint n_queries;
+  guint n_updates;
+} BenchTotals;
+
+static gboolean
+bench_entry_changed (guint kind,
+                     gint index)
+{
+  guint hash;
+
+  if (generation == 0)
+    return FALSE;
+
+  /* a cheap, stable mix of the entry and the generation */
+  hash = ((guint) index * 2654435761u) ^ (kind * 40503u) ^ (generation * 97u);
+  hash ^= hash >> 15;
+
+  return (hash % 10000) < (guint) (changed_percent * 100);
+}
+
+static gboolean
+bench_process_entry (TrackerSparqlConnection *connection,
+                     GHashTable *previous_resources,
+                     const gchar *datasource_urn,
+                     guint kind,
+                     gint index,
+                     GCancellable *cancellable,
+                     GError **error)
+{
+  static const gchar *kinds[] = { "folder", "document", "photo" };
+  static const gchar *classes[] = { "nfo:DataContainer", "nfo:PaginatedTextDocument", "nmm:Photo" };
+  gboolean resource_exists, mtime_changed;
+  gchar *resource = NULL;
+  gchar *identifier;
+  gchar *name;
+  gchar *date;
+  gint64 new_mtime;
+
+  identifier = g_strdup_printf ("%sbench:%s:%d", (kind == 0) ? "gd:collection:" : "", kinds[kind], index);
+  g_hash_table_remove (previous_resources, identifier);
+
+  resource = gom_tracker_sparql_connection_ensure_resource
+    (connection,
+     cancellable, error,
+     &resource_exists,
+     datasource_urn, identifier,
+     "nfo:RemoteDataObject", classes[kind], NULL);
+
+  if (*error != NULL)
+    goto out;
+
+  gom_tracker_update_datasource (connection, datasource_urn,
+                                 resource_exists, resource,
+                                 cancellable, error);
+
+  if (*error != NULL)
+    goto out;
+
+  new_mtime = BENCH_BASE_MTIME + (bench_entry_changed (kind, index) ? generation : 0);
+  mtime_changed = gom_tracker_update_mtime (connection, new_mtime,
+                                            resource_exists, datasource_urn, resource,
+                                            cancellable, error);
+
+  if (*error != NULL || !mtime_changed)
+    goto out;
+
+  gom_tracker_sparql_connection_insert_or_replace_triple
+    (connection,
+     cancellable, error,
+     datasource_urn, resource,
+     "nie:url", identifier);
+
+  if (*error != NULL)
+    goto out;
+
+  name = g_strdup_printf ("%s %d", kinds[kind], index);
+  gom_tracker_sparql_connection_insert_or_replace_triple
+    (connection,
+     cancellable, error,
+     datasource_urn, resource,
+     "nfo:fileName", name);
+  g_free (name);
+
+  if (*error != NULL)
+    goto out;
+
+  date = gom_iso8601_from_timestamp (BENCH_BASE_MTIME);
+  gom_tracker_sparql_connection_insert_or_replace_triple
+    (connection,
+     cancellable, error,
+     datasource_urn, resource,
+     "nie:contentCreated", date);
+  g_free (date);
+
+  if (*error != NULL)
+    goto out;
+
+  if (kind != 0 && n_folders > 0)
+    {
+      gchar *parent_identifier, *parent_resource;
+
+      parent_identifier = g_strdup_printf ("gd:collection:bench:folder:%d", index % n_folders);
+      parent_resource = gom_tracker_sparql_connection_ensure_resource
+        (connection, cancellable, error,
+         NULL,
+         datasource_urn, parent_identifier,
+         "nfo:RemoteDataObject", classes[0], NULL);
+      g_free (parent_identifier);
+
+      if (*error != NULL)
+        goto out;
+
+      gom_tracker_sparql_connection_insert_or_replace_triple
+        (connection,
+         cancellable, error,
+         datasource_urn, resource,
+         "nie:isPartOf", parent_resource);
+      g_free (parent_resource);
+
+      if (*error != NULL)
+        goto out;
+    }
+
+  if (kind != 0 && n_authors > 0)
+    {
+      gchar *contact_resource, *email, *fullname;
+
+      email = g_strdup_printf ("author%d@example.com", index % n_authors);
+      fullname = g_strdup_printf ("Author %d", index % n_authors);
+      contact_resource = gom_tracker_utils_ensure_contact_resource
+        (connection,
+         cancellable, error,
+         datasource_urn, email, fullname);
+      g_free (email);
+      g_free (fullname);
+
+      if (*error != NULL)
+        goto out;
+
+      gom_tracker_sparql_connection_insert_or_replace_triple
+        (connection,
+         cancellable, error,
+         datasource_urn, resource,
+         "nco:creator", contact_resource);
+      g_free (contact_resource);
+
+      if (*error != NULL)
+        goto out;
+    }
+
+  if (kind == 2)
+    {
+      gchar *equipment_resource;
+
+      equipment_resource = gom_tracker_utils_ensure_equipment_resource
+        (connection,
+         cancellable, error,
+         "Bench", (index % 2 == 0) ? "Even" : "Odd");
+
+      if (*error != NULL)
+        goto out;
+
+      gom_tracker_sparql_connection_insert_or_replace_triple
+        (connection,
+         cancellable, error,
+         datasource_urn, resource,
+         "nmm:camera", equipment_resource);
+      g_free (equipment_resource);
+
+      if (*error != NULL)
+        goto out;
+    }
+
+ out:
+  g_free (resource);
+  g_free (identifier);
+
+  if (*error != NULL)
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+query_bench (GomAccountMinerJob *job,
+             TrackerSparqlConnection *connection,
+             GHashTable *previous_resources,
+             const gchar *datasource_urn,
+             GCancellable *cancellable,
+             GError **error)
+{
+  const gint counts[] = { n_folders, n_documents, n_photos };
+  guint kind;
+  gint i;
+
+  for (kind = 0; kind < G_N_ELEMENTS (counts); kind++)
+    {
+      for (i = 0; i < counts[kind]; i++)
+        {
+          if (!bench_process_entry (connection, previous_resources, datasource_urn,
+                                    kind, i, cancellable, error))
+            return;
+        }
+    }
+}
+
+static GHashTable *
+create_services (GomMiner *self,
+                 GoaObject *object)
+{
+  return g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+static void
+gom_bench_miner_init (GomBenchMiner *self)
+{
+}
+
+static void
+gom_bench_miner_class_init (GomBenchMinerClass *klass)
+{
+  GomMinerClass *miner_class = GOM_MINER_CLASS (klass);
+
+  miner_class->goa_provider_type = "bench";
+  miner_class->miner_identifier = BENCH_MINER_IDENTIFIER;
+  miner_class->version = 1;
+  miner_class->migrations = migrations;
+
+  miner_class->create_services = create_services;
+  miner_class->query = query_bench;
+}
+
+static void
+bench_name_acquired_cb (GDBusConnection *connection,
+                        const gchar *name,
+                        gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+}
+
+static void
+bench_name_lost_cb (GDBusConnection *connection,
+                    const gchar *name,
+                    gpointer user_data)
+{
+  g_error ("Unable to own %s, is the benchmark running on a private session bus?", name);
+}
+
+static GDBusObjectManagerServer *
+bench_export_accounts (GDBusConnection *connection)
+{
+  GDBusObjectManagerServer *manager;
+  GMainLoop *loop;
+  gint i;
+
+  manager = g_dbus_object_manager_server_new ("/org/gnome/OnlineAccounts");
+
+  for (i = 0; i < n_accounts; i++)
+    {
+      GoaAccount *account;
+      GoaDocuments *documents;
+      GoaObjectSkeleton *object;
+      GoaPhotos *photos;
+      gchar *id, *path;
+
+      id = g_strdup_printf ("bench_%d", i);
+      path = g_strdup_printf ("/org/gnome/OnlineAccounts/Accounts/%s", id);
+
+      account = goa_account_skeleton_new ();
+      goa_account_set_id (account, id);
+      goa_account_set_provider_type (account, "bench");
+      goa_account_set_provider_name (account, "Benchmark");
+      goa_account_set_presentation_identity (account, id);
+
+      documents = goa_documents_skeleton_new ();
+      photos = goa_photos_skeleton_new ();
+
+      object = goa_object_skeleton_new (path);
+      goa_object_skeleton_set_account (object, account);
+      goa_object_skeleton_set_documents (object, documents);
+      goa_object_skeleton_set_photos (object, photos);
+      g_dbus_object_manager_server_export (manager, G_DBUS_OBJECT_SKELETON (object));
+
+      g_object_unref (object);
+      g_object_unref (photos);
+      g_object_unref (documents);
+      g_object_unref (account);
+      g_free (path);
+      g_free (id);
+    }
+
+  g_dbus_object_manager_server_set_connection (manager, connection);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_bus_own_name_on_connection (connection,
+                                "org.gnome.OnlineAccounts",
+                                G_BUS_NAME_OWNER_FLAGS_NONE,
+                                bench_name_acquired_cb,
+                                bench_name_lost_cb,
+                                loop, NULL);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+
+  return manager;
+}
+
+static void
+bench_account_refreshed_cb (GomMiner *miner,
+                            const gchar *account_id,
+                            GVariant *metrics,
+                            gpointer user_data)
+{
+  BenchTotals *totals = user_data;
+  guint value;
+
+  if (g_variant_lookup (metrics, "items-seen", "u", &value))
+    totals->n_seen += value;
+  if (g_variant_lookup (metrics, "items-changed", "u", &value))
+    totals->n_changed += value;
+  if (g_variant_lookup (metrics, "sparql-queries", "u", &value))
+    totals->n_queries += value;
+  if (g_variant_lookup (metrics, "sparql-updates", "u", &value))
+    totals->n_updates += value;
+}
+
+static void
+bench_refresh_db_cb (GObject *source,
+                     GAsyncResult *res,
+                     gpointer user_data)
+{
+  GError *error = NULL;
+
+  if (!gom_miner_refresh_db_finish (GOM_MINER (source), res, &error))
+    g_error ("Unable to refresh: %s", error->message);
+
+  g_main_loop_quit (user_data);
+}
+
+/* The resident set size in KiB, or 0 without /proc. Unlike ru_maxrss it
+ * can go down, so a phase is measured by how much it grew.
+ */
+static glong
+bench_current_rss (void)
+{
+  gchar *contents = NULL;
+  gchar *end;
+  glong pages = 0;
+
+  if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    {
+      /* the total size comes first, then the resident one */
+      g_ascii_strtoll (contents, &end, 10);
+      pages = (glong) g_ascii_strtoll (end, NULL, 10);
+    }
+
+  g_free (contents);
+  return pages * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static void
+bench_run (GomMiner *miner,
+           const gchar *name,
+           BenchTotals *out_totals)
+{
+  BenchTotals totals = { 0, };
+  GMainLoop *loop;
+  struct rusage usage;
+  gdouble seconds;
+  gint64 start;
+  glong rss;
+  gulong id;
+
+  id = g_signal_connect (miner, "account-refreshed", G_CALLBACK (bench_account_refreshed_cb), &totals);
+  loop = g_main_loop_new (NULL, FALSE);
+
+  rss = bench_current_rss ();
+  start = g_get_monotonic_time ();
+  gom_miner_refresh_db_async (miner, NULL, bench_refresh_db_cb, loop);
+  g_main_loop_run (loop);
+  seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+  g_main_loop_unref (loop);
+  g_signal_handler_disconnect (miner, id);
+
+  rss = bench_current_rss () - rss;
+
+  /* ru_maxrss is the peak of the whole process so far, not of this
+   * phase; the phases run one after the other in the same process
+   */
+  getrusage (RUSAGE_SELF, &usage);
+
+  g_print ("%-18s %9.2f s %10.1f items/s %7u changed %8.2f queries/item %8.2f updates/item "
+           "%+8ld KiB RSS %8ld KiB peak RSS so far\n",
+           name, seconds,
+           (seconds > 0) ? totals.n_seen / seconds : 0.0,
+           totals.n_changed,
+           (totals.n_seen > 0) ? (gdouble) totals.n_queries / totals.n_seen : 0.0,
+           (totals.n_seen > 0) ? (gdouble) totals.n_updates / totals.n_seen : 0.0,
+           rss,
+           usage.ru_maxrss);
+
+  if (out_totals != NULL)
+    *out_totals = totals;
+}
+
+static gint64
+bench_count (TrackerSparqlConnection *connection,
+             const gchar *sparql)
+{
+  GError *error = NULL;
+  TrackerSparqlCursor *cursor;
+  gint64 retval = 0;
+
+  cursor = tracker_sparql_connection_query (connection, sparql, NULL, &error);
+  if (cursor != NULL && tracker_sparql_cursor_next (cursor, NULL, &error))
+    retval = tracker_sparql_cursor_get_integer (cursor, 0);
+
+  if (error != NULL)
+    g_error ("Unable to query the store: %s", error->message);
+
+  g_clear_object (&cursor);
+  return retval;
+}
+
+/* Links the photos to a contact in the default graph, the way the
+ * miners did before contacts were kept in the graph of their account,
+ * bumps the version and checks that the next refresh migrates every
+ * datasource in place.
+ */
+static gboolean
+bench_run_migration (GomMiner *miner,
+                     TrackerSparqlConnection *connection)
+{
+  static const gchar count_resources[] =
+    "SELECT COUNT(?urn) WHERE { ?urn nie:dataSource ?datasource . "
+    "?datasource nao:identifier \"" BENCH_MINER_IDENTIFIER "\" }";
+  static const gchar count_legacy[] =
+    "SELECT COUNT(?urn) WHERE { ?urn ?property <" BENCH_LEGACY_CONTACT "> }";
+  static const gchar count_outdated[] =
+    "SELECT COUNT(?root) WHERE { ?root nie:rootElementOf ?datasource ; nie:version ?version . "
+    "?datasource nao:identifier \"" BENCH_MINER_IDENTIFIER "\" FILTER (?version != \"2\") }";
+  static const gchar count_contact[] =
+    "SELECT COUNT(?class) WHERE { <" BENCH_LEGACY_CONTACT "> a ?class }";
+  BenchTotals totals;
+  GError *error = NULL;
+  TrackerSparqlCursor *cursor;
+  gboolean retval = TRUE;
+  gchar *photo = NULL;
+  gchar *count_photo;
+  gint64 n_before, n_after;
+
+  tracker_sparql_connection_update (connection,
+                                    "INSERT { <mailto:legacy@example.com> a nco:EmailAddress ; "
+                                    "  nco:emailAddress \"legacy@example.com\" . "
+                                    "<" BENCH_LEGACY_CONTACT "> a nco:Contact ; "
+                                    "  nco:hasEmailAddress <mailto:legacy@example.com> ; "
+                                    "  nco:fullname \"Legacy author\" } "
+                                    "INSERT { ?urn nco:contributor <" BENCH_LEGACY_CONTACT "> } WHERE { "
+                                    "  ?urn a nmm:Photo ; nie:dataSource ?datasource . "
+                                    "  ?datasource nao:identifier \"" BENCH_MINER_IDENTIFIER "\" }",
+                                    G_PRIORITY_DEFAULT, NULL, &error);
+  if (error != NULL)
+    g_error ("Unable to write the legacy contacts: %s", error->message);
+
+  /* a purge would give it a new URN */
+  cursor = tracker_sparql_connection_query (connection,
+                                            "SELECT ?urn WHERE { ?urn a nmm:Photo ; nco:contributor <" BENCH_LEGACY_CONTACT "> } LIMIT 1",
+                                            NULL, &error);
+  if (cursor != NULL && tracker_sparql_cursor_next (cursor, NULL, &error))
+    photo = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
+
+  if (error != NULL)
+    g_error ("Unable to query the store: %s", error->message);
+
+  g_clear_object (&cursor);
+
+  n_before = bench_count (connection, count_resources);
+  GOM_MINER_GET_CLASS (miner)->version = 2;
+  bench_run (miner, "migrated refresh", &totals);
+  n_after = bench_count (connection, count_resources);
+
+  if (n_after != n_before)
+    {
+      g_printerr ("Migration: %" G_GINT64_FORMAT " resources before, %" G_GINT64_FORMAT " after\n",
+                  n_before, n_after);
+      retval = FALSE;
+    }
+
+  count_photo = g_strdup_printf ("SELECT COUNT(?class) WHERE { <%s> a ?class }", photo);
+  if (photo != NULL && bench_count (connection, count_photo) == 0)
+    {
+      g_printerr ("Migration: the datasources were mined again from scratch\n");
+      retval = FALSE;
+    }
+
+  g_free (count_photo);
+  g_free (photo);
+
+  if (totals.n_changed != totals.n_seen)
+    {
+      g_printerr ("Migration: only %u of %u entries were written again\n",
+                  totals.n_changed, totals.n_seen);
+      retval = FALSE;
+    }
+
+  if (bench_count (connection, count_legacy) != 0 || bench_count (connection, count_contact) != 0)
+    {
+      g_printerr ("Migration: the legacy contact is still there\n");
+      retval = FALSE;
+    }
+
+  if (bench_count (connection, count_outdated) != 0)
+    {
+      g_printerr ("Migration: some datasources still have an old version\n");
+      retval = FALSE;
+    }
+
+  return retval;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GDBusConnection *bus;
+  GDBusObjectManagerServer *manager;
+  GError *error = NULL;
+  GFile *store;
+  GOptionContext *context;
+  GomMiner *miner;
+  TrackerSparqlConnection *connection;
+  const gchar *index_types[] = { "documents", "photos", NULL };
+  gchar *name;
+  gchar *tmp_dir = NULL;
+  gboolean migrated;
+
+  context = g_option_context_new ("- benchmark the miner core");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (store_path == NULL)
+    {
+      tmp_dir = g_dir_make_tmp ("gom-bench-XXXXXX", &error);
+      if (tmp_dir == NULL)
+        {
+          g_printerr ("Unable to create the store: %s\n", error->message);
+          g_error_free (error);
+          return 1;
+        }
+    }
+
+  bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (bus == NULL)
+    {
+      g_printerr ("Unable to connect to the session bus: %s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+  manager = bench_export_accounts (bus);
+
+  store = g_file_new_for_path ((store_path != NULL) ? store_path : tmp_dir);
+  connection = tracker_sparql_connection_local_new (TRACKER_SPARQL_CONNECTION_FLAGS_NONE,
+                                                    store, NULL, NULL, &error);
+  g_object_unref (store);
+
+  if (connection == NULL)
+    {
+      g_printerr ("Unable to open the store: %s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+  miner = g_object_new (GOM_TYPE_BENCH_MINER, "connection", connection, NULL);
+  gom_miner_set_index_types (miner, index_types);
+
+  g_print ("%d account(s) of %d folders, %d documents and %d photos by %d authors, %.1f%% changed\n",
+           n_accounts, n_folders, n_documents, n_photos, n_authors, changed_percent);
+
+  bench_run (miner, "initial import", NULL);
+  bench_run (miner, "no-change refresh", NULL);
+
+  generation++;
+  name = g_strdup_printf ("%.1f%%-changed refresh", changed_percent);
+  bench_run (miner, name, NULL);
+  g_free (name);
+
+  migrated = bench_run_migration (miner, connection);
+
+  g_object_unref (miner);
+  g_object_unref (connection);
+  g_object_unref (manager);
+  g_object_unref (bus);
+
+  if (tmp_dir != NULL)
+    {
+      gchar *argv_rm[] = { "rm", "-rf", tmp_dir, NULL };
+
+      g_spawn_sync (NULL, argv_rm, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, NULL, NULL, NULL);
+      g_free (tmp_dir);
+    }
+
+  g_free (store_path);
+
+  return migrated ? 0 : 1;
+}
@@ -0,0 +1,796 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+/* Stands in for dleyna-server on the session bus, with synthetic media
+ * servers, so that the crawl of the media server miner can be load
+ * tested without any UPnP device around. Every server has the same
+ * tree: a root container with --fanout child containers, down to
+ * --depth levels, and --items photos spread over the containers of the
+ * last level. Containers and items are not stored anywhere, they are
+ * made up from their path on each call, so servers with millions of
+ * items are cheap.
+ *
+ * It owns com.intel.dleyna-server, so it has to run on a bus where the
+ * real one is not running, e.g. with dbus-run-session. The UDNs of the
+ * servers are printed at startup, for setting up the matching accounts.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "gom-dleyna-server-manager.h"
+#include "gom-dleyna-server-media-device.h"
+#include "gom-upnp-media-container2.h"
+
+#define MOCK_BUS_NAME "com.intel.dleyna-server"
+#define MOCK_MANAGER_PATH "/com/intel/dLeynaServer"
+#define MOCK_SERVER_PATH "/com/intel/dLeynaServer/server"
+
+static gint n_servers = 1;
+static gint n_items = 10000;
+static gint depth = 2;
+static gint fanout = 10;
+static gint latency = 0;
+static gboolean searchable = TRUE;
+
+static GOptionEntry entries[] = {
+  { "servers", 0, 0, G_OPTION_ARG_INT, &n_servers, "Number of servers (default: 1)", "N" },
+  { "items", 0, 0, G_OPTION_ARG_INT, &n_items, "Photos per server (default: 10000)", "N" },
+  { "depth", 0, 0, G_OPTION_ARG_INT, &depth, "Levels of containers below the root (default: 2)", "N" },
+  { "fanout", 0, 0, G_OPTION_ARG_INT, &fanout, "Child containers per container (default: 10)", "N" },
+  { "latency", 0, 0, G_OPTION_ARG_INT, &latency, "Delay of every method call, in milliseconds", "MS" },
+  { "no-search", 0, G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &searchable,
+    "Servers do not implement SearchObjects, and have to be crawled", NULL },
+  { NULL }
+};
+
+/* containers are numbered breadth first from the root, which is 0, so
+ * that the children of c are c * fanout + 1 to c * fanout + fanout
+ */
+static GMainLoop *mock_loop;
+
+static guint n_containers;
+static guint first_leaf;
+static guint n_leaves;
+
+typedef enum {
+  MOCK_NODE_SERVER,
+  MOCK_NODE_CONTAINER,
+  MOCK_NODE_ITEM
+} MockNodeType;
+
+typedef struct {
+  MockNodeType type;
+  guint server;
+  guint index;
+} MockNode;
+
+typedef struct {
+  GDBusMethodInvocation *invocation;
+  GVariant *parameters;
+  GError *error;
+} MockReply;
+
+static gboolean
+mock_tree_init (GError **error)
+{
+  guint64 level_size = 1;
+  guint64 total = 1;
+  gint level;
+
+  if (n_servers < 0 || n_items < 0 || depth < 0 || fanout < 0 || latency < 0)
+    {
+      g_set_error_literal (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                           "Negative values are not allowed");
+      return FALSE;
+    }
+
+  if (fanout == 0)
+    depth = 0;
+
+  for (level = 0; level < depth; level++)
+    {
+      level_size *= fanout;
+      total += level_size;
+
+      if (total > G_MAXINT32)
+        {
+          g_set_error_literal (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                               "Too many containers");
+          return FALSE;
+        }
+    }
+
+  n_containers = (guint) total;
+  n_leaves = (guint) level_size;
+  first_leaf = n_containers - n_leaves;
+
+  return TRUE;
+}
+
+static guint
+mock_leaf_first_item (guint leaf)
+{
+  return (guint) ((guint64) leaf * n_items / n_leaves);
+}
+
+static gboolean
+mock_node_parse (const gchar *node,
+                 MockNode *out)
+{
+  gchar *end;
+  guint64 value;
+
+  if (node == NULL)
+    return FALSE;
+
+  value = g_ascii_strtoull (node, &end, 10);
+  if (end == node || value >= (guint64) n_servers)
+    return FALSE;
+
+  out->server = (guint) value;
+  out->index = 0;
+
+  if (*end == '\0')
+    {
+      out->type = MOCK_NODE_SERVER;
+      return TRUE;
+    }
+
+  if (end[0] != '/' || (end[1] != 'c' && end[1] != 'i'))
+    return FALSE;
+
+  out->type = (end[1] == 'c') ? MOCK_NODE_CONTAINER : MOCK_NODE_ITEM;
+  node = end + 2;
+
+  value = g_ascii_strtoull (node, &end, 10);
+  if (end == node || *end != '\0')
+    return FALSE;
+
+  if (out->type == MOCK_NODE_CONTAINER && (value == 0 || value >= n_containers))
+    return FALSE;
+  if (out->type == MOCK_NODE_ITEM && value >= (guint64) n_items)
+    return FALSE;
+
+  out->index = (guint) value;
+  return TRUE;
+}
+
+static gchar *
+mock_container_path (guint server,
+                     guint container)
+{
+  if (container == 0)
+    return g_strdup_printf (MOCK_SERVER_PATH "/%u", server);
+
+  return g_strdup_printf (MOCK_SERVER_PATH "/%u/c%u", server, container);
+}
+
+static gboolean
+mock_node_from_path (const gchar *object_path,
+                     MockNode *out)
+{
+  if (!g_str_has_prefix (object_path, MOCK_SERVER_PATH "/"))
+    return FALSE;
+
+  return mock_node_parse (object_path + strlen (MOCK_SERVER_PATH "/"), out);
+}
+
+/* An empty filter asks for everything, like "*" */
+static gboolean
+mock_filter_has (const gchar *const *filter,
+                 const gchar *property)
+{
+  guint i;
+
+  if (filter[0] == NULL)
+    return TRUE;
+
+  for (i = 0; filter[i] != NULL; i++)
+    {
+      if (g_strcmp0 (filter[i], "*") == 0 || g_strcmp0 (filter[i], property) == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static GVariant *
+mock_container_new (guint server,
+                    guint container,
+                    const gchar *const *filter)
+{
+  GVariantBuilder builder;
+  gchar *path;
+
+  path = mock_container_path (server, container);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  if (mock_filter_has (filter, "Path"))
+    g_variant_builder_add (&builder, "{sv}", "Path", g_variant_new_object_path (path));
+  if (mock_filter_has (filter, "Type"))
+    g_variant_builder_add (&builder, "{sv}", "Type", g_variant_new_string ("container"));
+  if (mock_filter_has (filter, "DisplayName"))
+    {
+      gchar *name;
+
+      name = g_strdup_printf ("Folder %u", container);
+      g_variant_builder_add (&builder, "{sv}", "DisplayName", g_variant_new_string (name));
+      g_free (name);
+    }
+  if (mock_filter_has (filter, "ChildCount"))
+    {
+      guint child_count;
+
+      if (container < first_leaf)
+        child_count = fanout;
+      else
+        child_count = mock_leaf_first_item (container - first_leaf + 1)
+          - mock_leaf_first_item (container - first_leaf);
+
+      g_variant_builder_add (&builder, "{sv}", "ChildCount", g_variant_new_uint32 (child_count));
+    }
+
+  g_free (path);
+
+  return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+mock_item_new (guint server,
+               guint item,
+               const gchar *const *filter)
+{
+  GVariantBuilder builder;
+  gchar *path;
+
+  path = g_strdup_printf (MOCK_SERVER_PATH "/%u/i%u", server, item);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  if (mock_filter_has (filter, "Path"))
+    g_variant_builder_add (&builder, "{sv}", "Path", g_variant_new_object_path (path));
+  if (mock_filter_has (filter, "Type"))
+    g_variant_builder_add (&builder, "{sv}", "Type", g_variant_new_string ("image.photo"));
+  if (mock_filter_has (filter, "DisplayName"))
+    {
+      gchar *name;
+
+      name = g_strdup_printf ("IMG_%07u.jpg", item);
+      g_variant_builder_add (&builder, "{sv}", "DisplayName", g_variant_new_string (name));
+      g_free (name);
+    }
+  if (mock_filter_has (filter, "MIMEType"))
+    g_variant_builder_add (&builder, "{sv}", "MIMEType", g_variant_new_string ("image/jpeg"));
+  if (mock_filter_has (filter, "URLs"))
+    {
+      gchar *url;
+      const gchar *urls[2] = { NULL, NULL };
+
+      url = g_strdup_printf ("http://127.0.0.1/mock/%u/IMG_%07u.jpg", server, item);
+      urls[0] = url;
+      g_variant_builder_add (&builder, "{sv}", "URLs", g_variant_new_strv (urls, 1));
+      g_free (url);
+    }
+
+  g_free (path);
+
+  return g_variant_builder_end (&builder);
+}
+
+/* Which of the @count entries of a list are in the page, a @max of 0
+ * meaning all of them
+ */
+static void
+mock_page_clip (guint count,
+                guint offset,
+                guint max,
+                guint *first,
+                guint *n)
+{
+  *first = MIN (offset, count);
+  *n = count - *first;
+  if (max > 0)
+    *n = MIN (*n, max);
+}
+
+static GVariant *
+mock_list (const MockNode *node,
+           gboolean containers,
+           gboolean items,
+           guint offset,
+           guint max,
+           const gchar *const *filter)
+{
+  GVariantBuilder builder;
+  guint container;
+  guint first, i, n;
+
+  container = (node->type == MOCK_NODE_SERVER) ? 0 : node->index;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+
+  if (container < first_leaf)
+    {
+      if (containers)
+        {
+          mock_page_clip (fanout, offset, max, &first, &n);
+          for (i = first; i < first + n; i++)
+            g_variant_builder_add_value (&builder,
+                                         mock_container_new (node->server,
+                                                             container * fanout + 1 + i,
+                                                             filter));
+        }
+    }
+  else if (items)
+    {
+      guint leaf_first;
+
+      leaf_first = mock_leaf_first_item (container - first_leaf);
+      mock_page_clip (mock_leaf_first_item (container - first_leaf + 1) - leaf_first,
+                      offset, max, &first, &n);
+      for (i = first; i < first + n; i++)
+        g_variant_builder_add_value (&builder, mock_item_new (node->server, leaf_first + i, filter));
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+mock_search (const MockNode *node,
+             guint offset,
+             guint max,
+             const gchar *const *filter)
+{
+  GVariantBuilder builder;
+  guint first, i, n;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+
+  /* every item is a photo, so the query does not need to be looked at */
+  mock_page_clip (n_items, offset, max, &first, &n);
+  for (i = first; i < first + n; i++)
+    g_variant_builder_add_value (&builder, mock_item_new (node->server, i, filter));
+
+  return g_variant_builder_end (&builder);
+}
+
+static gboolean
+mock_reply_cb (gpointer user_data)
+{
+  MockReply *reply = user_data;
+
+  if (reply->error != NULL)
+    g_dbus_method_invocation_take_error (reply->invocation, reply->error);
+  else
+    g_dbus_method_invocation_return_value (reply->invocation, reply->parameters);
+
+  g_slice_free (MockReply, reply);
+
+  return FALSE;
+}
+
+/* Takes @parameters or @error */
+static void
+mock_return (GDBusMethodInvocation *invocation,
+             GVariant *parameters,
+             GError *error)
+{
+  MockReply *reply;
+
+  reply = g_slice_new0 (MockReply);
+  reply->invocation = invocation;
+  reply->parameters = parameters;
+  reply->error = error;
+
+  if (latency == 0)
+    mock_reply_cb (reply);
+  else
+    g_timeout_add ((guint) latency, mock_reply_cb, reply);
+}
+
+static void
+mock_container_method_call (GDBusConnection *connection,
+                            const gchar *sender,
+                            const gchar *object_path,
+                            const gchar *interface_name,
+                            const gchar *method_name,
+                            GVariant *parameters,
+                            GDBusMethodInvocation *invocation,
+                            gpointer user_data)
+{
+  MockNode node;
+  GVariant *children;
+  const gchar **filter = NULL;
+  const gchar *query;
+  const gchar *sort_by;
+  guint max, offset;
+
+  mock_node_from_path (object_path, &node);
+
+  if (g_strcmp0 (method_name, "ListChildren") == 0
+      || g_strcmp0 (method_name, "ListContainers") == 0
+      || g_strcmp0 (method_name, "ListItems") == 0)
+    {
+      g_variant_get (parameters, "(uu^a&s)", &offset, &max, &filter);
+    }
+  else if (g_strcmp0 (method_name, "ListChildrenEx") == 0
+           || g_strcmp0 (method_name, "ListContainersEx") == 0
+           || g_strcmp0 (method_name, "ListItemsEx") == 0)
+    {
+      g_variant_get (parameters, "(uu^a&s&s)", &offset, &max, &filter, &sort_by);
+    }
+  else if (g_strcmp0 (method_name, "SearchObjects") == 0
+           || g_strcmp0 (method_name, "SearchObjectsEx") == 0)
+    {
+      if (!searchable)
+        {
+          mock_return (invocation, NULL,
+                       g_error_new_literal (G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED,
+                                            "Searching is not supported"));
+          return;
+        }
+
+      if (g_strcmp0 (method_name, "SearchObjects") == 0)
+        g_variant_get (parameters, "(&suu^a&s)", &query, &offset, &max, &filter);
+      else
+        g_variant_get (parameters, "(&suu^a&s&s)", &query, &offset, &max, &filter, &sort_by);
+
+      children = mock_search (&node, offset, max, filter);
+      if (g_strcmp0 (method_name, "SearchObjects") == 0)
+        mock_return (invocation, g_variant_new_tuple (&children, 1), NULL);
+      else
+        mock_return (invocation, g_variant_new ("(@aa{sv}u)", children, (guint32) n_items), NULL);
+
+      g_free (filter);
+      return;
+    }
+  else
+    {
+      mock_return (invocation, NULL,
+                   g_error_new (G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED,
+                                "%s is not supported", method_name));
+      return;
+    }
+
+  children = mock_list (&node,
+                        !g_str_has_prefix (method_name, "ListItems"),
+                        !g_str_has_prefix (method_name, "ListContainers"),
+                        offset, max, filter);
+  mock_return (invocation, g_variant_new_tuple (&children, 1), NULL);
+  g_free (filter);
+}
+
+/* Properties that are not made up are empty */
+static GVariant *
+mock_default_value (const gchar *signature)
+{
+  const GVariantType *type = (const GVariantType *) signature;
+
+  switch (signature[0])
+    {
+    case 'a':
+      return g_variant_new_array (g_variant_type_element (type), NULL, 0);
+    case 'b':
+      return g_variant_new_boolean (FALSE);
+    case 'u':
+      return g_variant_new_uint32 (0);
+    case 'x':
+      return g_variant_new_int64 (0);
+    default:
+      return g_variant_new_string ("");
+    }
+}
+
+static GVariant *
+mock_container_get_property (GDBusConnection *connection,
+                             const gchar *sender,
+                             const gchar *object_path,
+                             const gchar *interface_name,
+                             const gchar *property_name,
+                             GError **error,
+                             gpointer user_data)
+{
+  GDBusPropertyInfo *info;
+  MockNode node;
+
+  mock_node_from_path (object_path, &node);
+
+  if (g_strcmp0 (property_name, "Searchable") == 0)
+    return g_variant_new_boolean (searchable);
+
+  if (g_strcmp0 (property_name, "ChildCount") == 0)
+    {
+      GVariant *container, *value;
+      const gchar *filter[] = { "ChildCount", NULL };
+
+      container = mock_container_new (node.server,
+                                      (node.type == MOCK_NODE_SERVER) ? 0 : node.index,
+                                      filter);
+      value = g_variant_lookup_value (container, "ChildCount", G_VARIANT_TYPE_UINT32);
+      g_variant_unref (g_variant_ref_sink (container));
+
+      return value;
+    }
+
+  info = g_dbus_interface_info_lookup_property (upnp_media_container2_interface_info (), property_name);
+  return mock_default_value (info->signature);
+}
+
+static void
+mock_device_method_call (GDBusConnection *connection,
+                         const gchar *sender,
+                         const gchar *object_path,
+                         const gchar *interface_name,
+                         const gchar *method_name,
+                         GVariant *parameters,
+                         GDBusMethodInvocation *invocation,
+                         gpointer user_data)
+{
+  if (g_strcmp0 (method_name, "Cancel") == 0)
+    mock_return (invocation, NULL, NULL);
+  else
+    mock_return (invocation, NULL,
+                 g_error_new (G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED,
+                              "%s is not supported", method_name));
+}
+
+static GVariant *
+mock_device_get_property (GDBusConnection *connection,
+                          const gchar *sender,
+                          const gchar *object_path,
+                          const gchar *interface_name,
+                          const gchar *property_name,
+                          GError **error,
+                          gpointer user_data)
+{
+  GDBusPropertyInfo *info;
+  GVariant *value;
+  MockNode node;
+  gchar *str;
+
+  mock_node_from_path (object_path, &node);
+
+  if (g_strcmp0 (property_name, "UDN") == 0)
+    {
+      str = g_strdup_printf ("uuid:00000000-0000-0000-0000-%012u", node.server);
+      value = g_variant_new_string (str);
+      g_free (str);
+      return value;
+    }
+
+  if (g_strcmp0 (property_name, "FriendlyName") == 0)
+    {
+      str = g_strdup_printf ("Mock Media Server %u", node.server);
+      value = g_variant_new_string (str);
+      g_free (str);
+      return value;
+    }
+
+  if (g_strcmp0 (property_name, "DeviceType") == 0)
+    return g_variant_new_string ("urn:schemas-upnp-org:device:MediaServer:1");
+
+  info = g_dbus_interface_info_lookup_property (dleyna_server_media_device_interface_info (),
+                                                property_name);
+  return mock_default_value (info->signature);
+}
+
+static const GDBusInterfaceVTable container_vtable = {
+  mock_container_method_call,
+  mock_container_get_property,
+  NULL
+};
+
+static const GDBusInterfaceVTable device_vtable = {
+  mock_device_method_call,
+  mock_device_get_property,
+  NULL
+};
+
+static gchar **
+mock_subtree_enumerate (GDBusConnection *connection,
+                        const gchar *sender,
+                        const gchar *object_path,
+                        gpointer user_data)
+{
+  GPtrArray *nodes;
+  gint i;
+
+  /* only the servers, the containers are found by listing them */
+  nodes = g_ptr_array_new ();
+  for (i = 0; i < n_servers; i++)
+    g_ptr_array_add (nodes, g_strdup_printf ("%d", i));
+  g_ptr_array_add (nodes, NULL);
+
+  return (gchar **) g_ptr_array_free (nodes, FALSE);
+}
+
+static GDBusInterfaceInfo **
+mock_subtree_introspect (GDBusConnection *connection,
+                         const gchar *sender,
+                         const gchar *object_path,
+                         const gchar *node,
+                         gpointer user_data)
+{
+  GPtrArray *interfaces;
+  MockNode parsed;
+
+  if (!mock_node_parse (node, &parsed) || parsed.type == MOCK_NODE_ITEM)
+    return NULL;
+
+  interfaces = g_ptr_array_new ();
+  if (parsed.type == MOCK_NODE_SERVER)
+    g_ptr_array_add (interfaces,
+                     g_dbus_interface_info_ref (dleyna_server_media_device_interface_info ()));
+  g_ptr_array_add (interfaces, g_dbus_interface_info_ref (upnp_media_container2_interface_info ()));
+  g_ptr_array_add (interfaces, NULL);
+
+  return (GDBusInterfaceInfo **) g_ptr_array_free (interfaces, FALSE);
+}
+
+static const GDBusInterfaceVTable *
+mock_subtree_dispatch (GDBusConnection *connection,
+                       const gchar *sender,
+                       const gchar *object_path,
+                       const gchar *interface_name,
+                       const gchar *node,
+                       gpointer *out_user_data,
+                       gpointer user_data)
+{
+  MockNode parsed;
+  const GDBusInterfaceVTable *vtable = NULL;
+
+  if (!mock_node_parse (node, &parsed) || parsed.type == MOCK_NODE_ITEM)
+    return NULL;
+
+  if (g_strcmp0 (interface_name, "org.gnome.UPnP.MediaContainer2") == 0)
+    vtable = &container_vtable;
+  else if (g_strcmp0 (interface_name, "com.intel.dLeynaServer.MediaDevice") == 0
+           && parsed.type == MOCK_NODE_SERVER)
+    vtable = &device_vtable;
+
+  /* the handlers find the node again from the object path */
+  *out_user_data = NULL;
+
+  return vtable;
+}
+
+static const GDBusSubtreeVTable subtree_vtable = {
+  mock_subtree_enumerate,
+  mock_subtree_introspect,
+  mock_subtree_dispatch
+};
+
+static gboolean
+mock_handle_get_servers (DleynaServerManager *manager,
+                         GDBusMethodInvocation *invocation,
+                         gpointer user_data)
+{
+  GPtrArray *paths;
+  gint i;
+
+  paths = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < n_servers; i++)
+    g_ptr_array_add (paths, mock_container_path ((guint) i, 0));
+  g_ptr_array_add (paths, NULL);
+
+  dleyna_server_manager_complete_get_servers (manager, invocation,
+                                              (const gchar *const *) paths->pdata);
+  g_ptr_array_unref (paths);
+
+  return TRUE;
+}
+
+static void
+mock_bus_acquired_cb (GDBusConnection *connection,
+                      const gchar *name,
+                      gpointer user_data)
+{
+  DleynaServerManager *manager = user_data;
+  GError *error = NULL;
+
+  if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (manager),
+                                         connection,
+                                         MOCK_MANAGER_PATH,
+                                         &error))
+    g_error ("Unable to export the manager: %s", error->message);
+
+  if (g_dbus_connection_register_subtree (connection,
+                                          MOCK_SERVER_PATH,
+                                          &subtree_vtable,
+                                          G_DBUS_SUBTREE_FLAGS_DISPATCH_TO_UNENUMERATED_NODES,
+                                          NULL, NULL,
+                                          &error) == 0)
+    g_error ("Unable to export the servers: %s", error->message);
+}
+
+static void
+mock_name_acquired_cb (GDBusConnection *connection,
+                       const gchar *name,
+                       gpointer user_data)
+{
+  gint i;
+
+  for (i = 0; i < n_servers; i++)
+    g_print ("uuid:00000000-0000-0000-0000-%012d " MOCK_SERVER_PATH "/%d\n", i, i);
+}
+
+static void
+mock_name_lost_cb (GDBusConnection *connection,
+                   const gchar *name,
+                   gpointer user_data)
+{
+  g_printerr ("Unable to own %s, is dleyna-server running on this bus?\n", name);
+  g_main_loop_quit (mock_loop);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  DleynaServerManager *manager;
+  GError *error = NULL;
+  GOptionContext *context;
+  guint owner_id;
+
+  context = g_option_context_new ("- stand in for dleyna-server with synthetic media servers");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)
+      || !mock_tree_init (&error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  g_printerr ("%d server(s) of %u containers and %d items, %s, %d ms per call\n",
+              n_servers, n_containers, n_items,
+              searchable ? "searchable" : "not searchable", latency);
+
+  manager = dleyna_server_manager_skeleton_new ();
+  g_signal_connect (manager, "handle-get-servers", G_CALLBACK (mock_handle_get_servers), NULL);
+
+  mock_loop = g_main_loop_new (NULL, FALSE);
+
+  owner_id = g_bus_own_name (G_BUS_TYPE_SESSION,
+                             MOCK_BUS_NAME,
+                             G_BUS_NAME_OWNER_FLAGS_NONE,
+                             mock_bus_acquired_cb,
+                             mock_name_acquired_cb,
+                             mock_name_lost_cb,
+                             manager, NULL);
+
+  /* only quits if the name could not be owned */
+  g_main_loop_run (mock_loop);
+
+  g_bus_unown_name (owner_id);
+  g_main_loop_unref (mock_loop);
+  g_object_unref (manager);
+
+  return 1;
+}
@@ -26,13 +26,35 @@
 #include <goa/goa.h>
 #include <gfbgraph/gfbgraph.h>
 #include <gfbgraph/gfbgraph-goa-authorizer.h>
+#include <json-glib/json-glib.h>
+#include <json-glib/json-gobject.h>
+#include <rest/rest-proxy-call.h>
 
 #include "gom-facebook-miner.h"
+#include "gom-fetch-pool.h"
+#include "gom-recorder.h"
+#include "gom-trace.h"
 
 #define MINER_IDENTIFIER "gd:facebook:miner:9972c7ff-a30f-4dd4-bc77-1adf9dd14364"
 
+/* the Graph API caps connection pages at 100 entries */
+#define PHOTOS_PAGE_SIZE "100"
+
+static const gint MAX_PHOTO_FETCHES = 4;
+
 G_DEFINE_TYPE (GomFacebookMiner, gom_facebook_miner, GOM_TYPE_MINER)
 
+typedef struct {
+  GFBGraphAlbum *album;
+  gchar *album_resource;
+  gchar *after;
+
+  /* filled in by fetch_photos_page */
+  GList *photos;
+  gchar *next;
+  gsize n_bytes;
+} PhotosPage;
+
 static gboolean
 account_miner_job_process_photo (GomAccountMinerJob *job,
                                  TrackerSparqlConnection *connection,
@@ -77,7 +99,7 @@ account_miner_job_process_photo (GomAccountMinerJob *job,
     goto out;
 
   gom_tracker_update_datasource (connection, datasource_urn,
-                                 resource_exists, identifier, resource,
+                                 resource_exists, resource,
                                  cancellable, error);
   if (*error != NULL)
     goto out;
@@ -89,7 +111,7 @@ account_miner_job_process_photo (GomAccountMinerJob *job,
   else
     {
       mtime_changed = gom_tracker_update_mtime (connection, new_mtime.tv_sec,
-                                                resource_exists, identifier, resource,
+                                                resource_exists, datasource_urn, resource,
                                                 cancellable, error);
       if (*error != NULL)
         goto out;
@@ -141,6 +163,7 @@ account_miner_job_process_photo (GomAccountMinerJob *job,
   contact_resource = gom_tracker_utils_ensure_contact_resource
     (connection,
      cancellable, error,
+     datasource_urn,
      datasource_urn, creator);
 
   if (*error != NULL)
@@ -178,7 +201,7 @@ account_miner_job_process_photo (GomAccountMinerJob *job,
 /* TODO: Until GFBGraph parse the "from" node section, we require the
  *  album creator (generally the logged user)
  */
-static gboolean
+static gchar *
 account_miner_job_process_album (GomAccountMinerJob *job,
                                  TrackerSparqlConnection *connection,
                                  GHashTable *previous_resources,
@@ -198,11 +221,7 @@ account_miner_job_process_album (GomAccountMinerJob *job,
   gchar *resource = NULL;
   gboolean resource_exists;
   gchar *contact_resource;
-  GList *l;
-  GList *photos = NULL;
-  GFBGraphAuthorizer *authorizer;
 
-  authorizer = GFBGRAPH_AUTHORIZER (g_hash_table_lookup (job->services, "photos"));
   album_id = gfbgraph_node_get_id (GFBGRAPH_NODE (album));
   album_link = gfbgraph_node_get_link (GFBGRAPH_NODE (album));
   album_created_time = gfbgraph_node_get_created_time (GFBGRAPH_NODE (album));
@@ -226,7 +245,7 @@ account_miner_job_process_album (GomAccountMinerJob *job,
     goto out;
 
   gom_tracker_update_datasource (connection, datasource_urn,
-                                 resource_exists, identifier, resource,
+                                 resource_exists, resource,
                                  cancellable, error);
 
   if (*error != NULL)
@@ -266,6 +285,7 @@ account_miner_job_process_album (GomAccountMinerJob *job,
   contact_resource = gom_tracker_utils_ensure_contact_resource
     (connection,
      cancellable, error,
+     datasource_urn,
      datasource_urn, creator);
 
   if (*error != NULL)
@@ -290,48 +310,165 @@ account_miner_job_process_album (GomAccountMinerJob *job,
   if (*error != NULL)
     goto out;
 
-  /* Album photos */
-  photos = gfbgraph_node_get_connection_nodes (GFBGRAPH_NODE (album),
-                                               GFBGRAPH_TYPE_PHOTO,
-                                               authorizer,
-                                               error);
+ out:
+  g_free (identifier);
+
   if (*error != NULL)
+    {
+      g_free (resource);
+      return NULL;
+    }
+
+  return resource;
+}
+
+static PhotosPage *
+photos_page_new (GFBGraphAlbum *album,
+                 const gchar *album_resource,
+                 const gchar *after)
+{
+  PhotosPage *page;
+
+  page = g_slice_new0 (PhotosPage);
+  page->album = g_object_ref (album);
+  page->album_resource = g_strdup (album_resource);
+  page->after = g_strdup (after);
+
+  return page;
+}
+
+static void
+photos_page_free (PhotosPage *page)
+{
+  g_list_free_full (page->photos, g_object_unref);
+  g_clear_object (&page->album);
+  g_free (page->album_resource);
+  g_free (page->after);
+  g_free (page->next);
+  g_slice_free (PhotosPage, page);
+}
+
+/* gfbgraph_node_get_connection_nodes() only ever returns the first page
+ * of a connection, so talk to the Graph API directly and follow the
+ * paging cursors ourselves. The page is recorded with GOM_RECORD_FILE,
+ * and served from the recording with GOM_REPLAY_FILE.
+ */
+static gpointer
+fetch_photos_page (gpointer item,
+                   gpointer user_data,
+                   GCancellable *cancellable,
+                   GError **error)
+{
+  GFBGraphAuthorizer *authorizer = GFBGRAPH_AUTHORIZER (user_data);
+  JsonArray *data;
+  JsonObject *root, *paging;
+  JsonParser *parser = NULL;
+  PhotosPage *page = item;
+  RestProxyCall *call = NULL;
+  GBytes *payload = NULL;
+  GError *local_error = NULL;
+  GList *nodes = NULL, *l;
+  gchar *function;
+  gchar *url;
+  gint64 time;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return NULL;
+
+  function = g_strdup_printf ("%s/photos", gfbgraph_node_get_id (GFBGRAPH_NODE (page->album)));
+
+  /* what the recording is keyed on, without the access token */
+  url = g_strdup_printf ("%s?limit=%s%s%s",
+                         function,
+                         PHOTOS_PAGE_SIZE,
+                         (page->after != NULL) ? "&after=" : "",
+                         (page->after != NULL) ? page->after : "");
+
+  if (!gom_recorder_replay_http ("GET", url, &payload, &local_error))
+    {
+      call = gfbgraph_new_rest_call (authorizer);
+      rest_proxy_call_set_function (call, function);
+      rest_proxy_call_set_method (call, "GET");
+      rest_proxy_call_add_param (call, "limit", PHOTOS_PAGE_SIZE);
+      if (page->after != NULL)
+        rest_proxy_call_add_param (call, "after", page->after);
+
+      time = g_get_monotonic_time ();
+      if (rest_proxy_call_sync (call, &local_error))
+        payload = g_bytes_new (rest_proxy_call_get_payload (call),
+                               rest_proxy_call_get_payload_length (call));
+
+      gom_recorder_record_http ("GET", url, payload, local_error, time);
+    }
+
+  g_free (function);
+  g_free (url);
+
+  if (local_error != NULL)
+    {
+      g_propagate_error (error, local_error);
+      goto out;
+    }
+
+  page->n_bytes = g_bytes_get_size (payload);
+
+  parser = json_parser_new ();
+  if (!json_parser_load_from_data (parser,
+                                   (const gchar *) g_bytes_get_data (payload, NULL),
+                                   g_bytes_get_size (payload),
+                                   error))
     goto out;
 
-  for (l = photos; l != NULL; l = l->next)
+  root = json_node_get_object (json_parser_get_root (parser));
+  if (root == NULL || !json_object_has_member (root, "data"))
     {
-      GError *local_error = NULL;
-      GFBGraphPhoto *photo = GFBGRAPH_PHOTO (l->data);
-
-      account_miner_job_process_photo (job,
-                                       connection,
-                                       previous_resources,
-                                       datasource_urn,
-                                       photo,
-                                       resource,
-                                       creator,
-                                       cancellable,
-                                       &local_error);
-      if (local_error != NULL)
+      /* FIXME: use proper #defines and enumerated types */
+      g_set_error (error,
+                   g_quark_from_static_string ("gom-error"),
+                   0,
+                   "Malformed photos connection");
+      goto out;
+    }
+
+  data = json_object_get_array_member (root, "data");
+  nodes = json_array_get_elements (data);
+  for (l = nodes; l != NULL; l = l->next)
+    {
+      GObject *photo;
+
+      photo = json_gobject_deserialize (GFBGRAPH_TYPE_PHOTO, l->data);
+      if (photo != NULL)
+        page->photos = g_list_prepend (page->photos, photo);
+    }
+
+  page->photos = g_list_reverse (page->photos);
+
+  /* the "next" link is only present if there is another page */
+  if (json_object_has_member (root, "paging"))
+    {
+      paging = json_object_get_object_member (root, "paging");
+      if (json_object_has_member (paging, "next") && json_object_has_member (paging, "cursors"))
         {
-          const gchar *photo_id;
+          JsonObject *cursors;
 
-          photo_id = gfbgraph_node_get_id (GFBGRAPH_NODE (photo));
-          g_warning ("Unable to process %s: %s", photo_id, local_error->message);
-          g_clear_error (&local_error);
+          cursors = json_object_get_object_member (paging, "cursors");
+          if (json_object_has_member (cursors, "after"))
+            page->next = g_strdup (json_object_get_string_member (cursors, "after"));
         }
     }
 
  out:
-  g_free (resource);
-  g_free (identifier);
-
-  g_list_free_full (photos, g_object_unref);
+  g_list_free (nodes);
+  g_clear_object (&parser);
+  g_clear_object (&call);
+  if (payload != NULL)
+    g_bytes_unref (payload);
 
   if (*error != NULL)
-    return FALSE;
+    return NULL;
 
-  return TRUE;
+  /* the page itself carries the result */
+  return page;
 }
 
 static void
@@ -344,10 +481,13 @@ query_facebook (GomAccountMinerJob *job,
 {
   GFBGraphAuthorizer *authorizer;
   GFBGraphUser *me = NULL;
+  GomFetchPool *pool = NULL;
+  PhotosPage *page;
   const gchar *me_name;
   GList *albums = NULL;
   GList *l = NULL;
   GError *local_error = NULL;
+  gboolean listing_failed = FALSE;
 
   authorizer = GFBGRAPH_AUTHORIZER (g_hash_table_lookup (job->services, "photos"));
   if (authorizer == NULL)
@@ -370,18 +510,31 @@ query_facebook (GomAccountMinerJob *job,
   if (local_error != NULL)
     goto out;
 
+  /* the photo pages of all albums are fetched concurrently, and each
+   * page is written as soon as it arrives; the next page of an album is
+   * only requested once the cursor of the previous one is known.
+   */
+  pool = gom_fetch_pool_new (MAX_PHOTO_FETCHES,
+                             fetch_photos_page, authorizer,
+                             (GDestroyNotify) photos_page_free, NULL,
+                             cancellable);
+
   for (l = albums; l != NULL; l = l->next)
     {
       GFBGraphAlbum *album = GFBGRAPH_ALBUM (l->data);
-
-      account_miner_job_process_album (job,
-                                       connection,
-                                       previous_resources,
-                                       datasource_urn,
-                                       album,
-                                       me_name,
-                                       cancellable,
-                                       &local_error);
+      gchar *album_resource;
+      gint64 trace;
+
+      trace = gom_trace_begin ();
+      album_resource = account_miner_job_process_album (job,
+                                                        connection,
+                                                        previous_resources,
+                                                        datasource_urn,
+                                                        album,
+                                                        me_name,
+                                                        cancellable,
+                                                        &local_error);
+      gom_trace_end (trace, "entry", "album");
       if (local_error != NULL)
         {
           const gchar *album_id;
@@ -389,10 +542,76 @@ query_facebook (GomAccountMinerJob *job,
           album_id = gfbgraph_node_get_id (GFBGRAPH_NODE (album));
           g_warning ("Unable to process %s: %s", album_id, local_error->message);
           g_clear_error (&local_error);
+          listing_failed = TRUE;
+          continue;
         }
+
+      gom_fetch_pool_push (pool, photos_page_new (album, album_resource, NULL));
+      g_free (album_resource);
+    }
+
+  while (gom_fetch_pool_pop (pool, (gpointer *) &page, NULL, &local_error))
+    {
+      if (local_error != NULL)
+        {
+          const gchar *album_id;
+
+          if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            {
+              photos_page_free (page);
+              break;
+            }
+
+          album_id = gfbgraph_node_get_id (GFBGRAPH_NODE (page->album));
+          g_warning ("Unable to fetch the photos of %s: %s", album_id, local_error->message);
+          g_clear_error (&local_error);
+          photos_page_free (page);
+          listing_failed = TRUE;
+          continue;
+        }
+
+      gom_account_miner_job_add_bytes_fetched (job, page->n_bytes);
+
+      if (page->next != NULL)
+        gom_fetch_pool_push (pool, photos_page_new (page->album, page->album_resource, page->next));
+
+      for (l = page->photos; l != NULL; l = l->next)
+        {
+          GFBGraphPhoto *photo = GFBGRAPH_PHOTO (l->data);
+          gint64 trace;
+
+          trace = gom_trace_begin ();
+          account_miner_job_process_photo (job,
+                                           connection,
+                                           previous_resources,
+                                           datasource_urn,
+                                           photo,
+                                           page->album_resource,
+                                           me_name,
+                                           cancellable,
+                                           &local_error);
+          gom_trace_end (trace, "entry", "photo");
+          if (local_error != NULL)
+            {
+              const gchar *photo_id;
+
+              photo_id = gfbgraph_node_get_id (GFBGRAPH_NODE (photo));
+              g_warning ("Unable to process %s: %s", photo_id, local_error->message);
+              g_clear_error (&local_error);
+            }
+        }
+
+      photos_page_free (page);
     }
 
  out:
+  if (pool != NULL)
+    gom_fetch_pool_free (pool);
+
+  /* the photos that were not listed are not gone */
+  if (listing_failed)
+    g_hash_table_remove_all (previous_resources);
+
   if (local_error != NULL)
     g_propagate_error (error, local_error);
 
@@ -433,6 +652,12 @@ gom_facebook_miner_init (GomFacebookMiner *miner)
 {
 }
 
+/* 3: contacts are kept in the graph of their account */
+static const GomMinerMigration migrations[] = {
+  { 3, GOM_MINER_MIGRATION_CONTACTS_INTO_GRAPH, TRUE },
+  { 0, }
+};
+
 static void
 gom_facebook_miner_class_init (GomFacebookMinerClass *klass)
 {
@@ -440,7 +665,8 @@ gom_facebook_miner_class_init (GomFacebookMinerClass *klass)
 
   miner_class->goa_provider_type = "facebook";
   miner_class->miner_identifier = MINER_IDENTIFIER;
-  miner_class->version = 2;
+  miner_class->version = 3;
+  miner_class->migrations = migrations;
 
   miner_class->create_services = create_services;
   miner_class->query = query_facebook;
@@ -0,0 +1,186 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "gom-fetch-pool.h"
+#include "gom-trace.h"
+
+struct _GomFetchPool {
+  GThreadPool *pool;
+  GAsyncQueue *results;
+  GCancellable *cancellable;
+
+  GomFetchFunc func;
+  gpointer user_data;
+  GDestroyNotify item_destroy;
+  GDestroyNotify result_destroy;
+
+  /* of the thread that created the pool, for tracing */
+  gchar *account_id;
+
+  gint pending;
+  gint stopping;
+};
+
+typedef struct {
+  gpointer item;
+  gpointer result;
+  GError *error;
+} GomFetchResult;
+
+static void
+gom_fetch_pool_thread_func (gpointer data,
+                            gpointer user_data)
+{
+  GomFetchPool *pool = user_data;
+  GomFetchResult *res;
+  gint64 trace;
+
+  res = g_slice_new0 (GomFetchResult);
+  res->item = data;
+
+  /* once the pool is being torn down, just hand the item back so that
+   * gom_fetch_pool_free() can release it.
+   */
+  if (!g_atomic_int_get (&pool->stopping))
+    {
+      gom_trace_set_thread_account (pool->account_id);
+      trace = gom_trace_begin ();
+      res->result = pool->func (data, pool->user_data, pool->cancellable, &res->error);
+      gom_trace_end (trace, "fetch", "item");
+      gom_trace_set_thread_account (NULL);
+    }
+
+  g_async_queue_push (pool->results, res);
+}
+
+static void
+gom_fetch_result_free (GomFetchPool *pool,
+                       GomFetchResult *res)
+{
+  if (res->item != NULL && pool->item_destroy != NULL)
+    pool->item_destroy (res->item);
+
+  if (res->result != NULL && pool->result_destroy != NULL)
+    pool->result_destroy (res->result);
+
+  g_clear_error (&res->error);
+  g_slice_free (GomFetchResult, res);
+}
+
+GomFetchPool *
+gom_fetch_pool_new (gint max_fetches,
+                    GomFetchFunc func,
+                    gpointer user_data,
+                    GDestroyNotify item_destroy,
+                    GDestroyNotify result_destroy,
+                    GCancellable *cancellable)
+{
+  GomFetchPool *pool;
+
+  g_return_val_if_fail (max_fetches > 0, NULL);
+  g_return_val_if_fail (func != NULL, NULL);
+
+  pool = g_slice_new0 (GomFetchPool);
+  pool->func = func;
+  pool->user_data = user_data;
+  pool->item_destroy = item_destroy;
+  pool->result_destroy = result_destroy;
+  pool->cancellable = (cancellable != NULL) ? g_object_ref (cancellable) : NULL;
+  pool->account_id = g_strdup (gom_trace_get_thread_account ());
+  pool->results = g_async_queue_new ();
+  /* exclusive, so that the threads inherit the priority of the one
+   * creating the pool, and are not handed to other work afterwards
+   */
+  pool->pool = g_thread_pool_new (gom_fetch_pool_thread_func, pool, max_fetches, TRUE, NULL);
+
+  return pool;
+}
+
+void
+gom_fetch_pool_push (GomFetchPool *pool,
+                     gpointer item)
+{
+  g_return_if_fail (item != NULL);
+
+  g_atomic_int_inc (&pool->pending);
+  g_thread_pool_push (pool->pool, item, NULL);
+}
+
+/* Blocks until one of the pushed items has been fetched, and transfers
+ * ownership of the item and of its result to the caller. Returns FALSE
+ * once every pushed item has been popped. A failed fetch is reported
+ * through @error with a NULL @result, but the item is still returned so
+ * that the caller can tell which one failed.
+ */
+gboolean
+gom_fetch_pool_pop (GomFetchPool *pool,
+                    gpointer *item,
+                    gpointer *result,
+                    GError **error)
+{
+  GomFetchResult *res;
+
+  if (g_atomic_int_get (&pool->pending) == 0)
+    return FALSE;
+
+  res = g_async_queue_pop (pool->results);
+  g_atomic_int_add (&pool->pending, -1);
+
+  if (item != NULL)
+    {
+      *item = res->item;
+      res->item = NULL;
+    }
+
+  if (result != NULL)
+    {
+      *result = res->result;
+      res->result = NULL;
+    }
+
+  if (res->error != NULL)
+    {
+      g_propagate_error (error, res->error);
+      res->error = NULL;
+    }
+
+  gom_fetch_result_free (pool, res);
+  return TRUE;
+}
+
+void
+gom_fetch_pool_free (GomFetchPool *pool)
+{
+  GomFetchResult *res;
+
+  g_atomic_int_set (&pool->stopping, 1);
+  g_thread_pool_free (pool->pool, FALSE, TRUE);
+
+  while ((res = g_async_queue_try_pop (pool->results)) != NULL)
+    gom_fetch_result_free (pool, res);
+
+  g_async_queue_unref (pool->results);
+  g_clear_object (&pool->cancellable);
+  g_free (pool->account_id);
+  g_slice_free (GomFetchPool, pool);
+}
@@ -0,0 +1,59 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+#ifndef __GOM_FETCH_POOL_H__
+#define __GOM_FETCH_POOL_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GomFetchPool GomFetchPool;
+
+/* Runs in one of the pool's threads. Must only talk to the remote
+ * service, never to the tracker store: results are handed back to the
+ * thread calling gom_fetch_pool_pop(), which does all the writing.
+ */
+typedef gpointer (*GomFetchFunc) (gpointer item,
+                                  gpointer user_data,
+                                  GCancellable *cancellable,
+                                  GError **error);
+
+GomFetchPool *gom_fetch_pool_new (gint max_fetches,
+                                  GomFetchFunc func,
+                                  gpointer user_data,
+                                  GDestroyNotify item_destroy,
+                                  GDestroyNotify result_destroy,
+                                  GCancellable *cancellable);
+
+void gom_fetch_pool_push (GomFetchPool *pool,
+                          gpointer item);
+
+gboolean gom_fetch_pool_pop (GomFetchPool *pool,
+                             gpointer *item,
+                             gpointer *result,
+                             GError **error);
+
+void gom_fetch_pool_free (GomFetchPool *pool);
+
+G_END_DECLS
+
+#endif /* __GOM_FETCH_POOL_H__ */
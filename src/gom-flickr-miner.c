@@ -26,6 +26,7 @@
 #include <grilo.h>
 
 #include "gom-flickr-miner.h"
+#include "gom-trace.h"
 #include "gom-utils.h"
 
 #define MINER_IDENTIFIER "gd:flickr:miner:3c63f509-23e8-4283-8aed-154bb55ef07b"
@@ -150,7 +151,7 @@ account_miner_job_process_entry (GomAccountMinerJob *job,
     goto out;
 
   gom_tracker_update_datasource (connection, datasource_urn,
-                                 resource_exists, identifier, resource,
+                                 resource_exists, resource,
                                  cancellable, error);
 
   if (*error != NULL)
@@ -202,7 +203,7 @@ account_miner_job_process_entry (GomAccountMinerJob *job,
   created_time = modification_date = grl_media_get_creation_date (entry->media);
   new_mtime = g_date_time_to_unix (modification_date);
   mtime_changed = gom_tracker_update_mtime (connection, new_mtime,
-                                            resource_exists, identifier, resource,
+                                            resource_exists, datasource_urn, resource,
                                             cancellable, error);
 
   if (*error != NULL)
@@ -265,6 +266,7 @@ account_miner_job_process_entry (GomAccountMinerJob *job,
   contact_resource = gom_tracker_utils_ensure_contact_resource
     (connection,
      cancellable, error,
+     datasource_urn,
      datasource_urn, grl_media_get_author (entry->media));
 
   if (*error != NULL)
@@ -311,8 +313,10 @@ source_browse_cb (GrlSource *source,
   if (media != NULL)
     {
       FlickrEntry *entry;
+      gint64 trace;
 
       entry = create_entry (media, data->parent_entry->media);
+      trace = gom_trace_begin ();
       account_miner_job_process_entry (data->job,
                                        data->connection,
                                        data->previous_resources,
@@ -321,6 +325,7 @@ source_browse_cb (GrlSource *source,
                                        entry,
                                        data->cancellable,
                                        &local_error);
+      gom_trace_end (trace, "entry", "entry");
       if (local_error != NULL)
         {
           g_warning ("Unable to process entry %p: %s", media, local_error->message);
@@ -401,8 +406,10 @@ source_search_cb (GrlSource *source,
   if (media != NULL)
     {
       FlickrEntry *entry;
+      gint64 trace;
 
       entry = create_entry (media, NULL);
+      trace = gom_trace_begin ();
       account_miner_job_process_entry (data->job,
                                        data->connection,
                                        data->previous_resources,
@@ -411,6 +418,7 @@ source_search_cb (GrlSource *source,
                                        entry,
                                        data->cancellable,
                                        &local_error);
+      gom_trace_end (trace, "entry", "entry");
       if (local_error != NULL)
         {
           g_warning ("Unable to process entry %p: %s", media, local_error->message);
@@ -576,6 +584,12 @@ gom_flickr_miner_init (GomFlickrMiner *self)
   self->priv->boxes = g_queue_new ();
 }
 
+/* 2: contacts are kept in the graph of their account */
+static const GomMinerMigration migrations[] = {
+  { 2, GOM_MINER_MIGRATION_CONTACTS_INTO_GRAPH, TRUE },
+  { 0, }
+};
+
 static void
 gom_flickr_miner_class_init (GomFlickrMinerClass *klass)
 {
@@ -588,7 +602,8 @@ gom_flickr_miner_class_init (GomFlickrMinerClass *klass)
 
   miner_class->goa_provider_type = "flickr";
   miner_class->miner_identifier = MINER_IDENTIFIER;
-  miner_class->version = 1;
+  miner_class->version = 2;
+  miner_class->migrations = migrations;
 
   miner_class->create_services = create_services;
   miner_class->query = query_flickr;
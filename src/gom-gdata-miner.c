@@ -23,8 +23,13 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gdata/gdata.h>
 
+#include "gom-fetch-pool.h"
+#include "gom-pager.h"
+#include "gom-trace.h"
 #include "gom-utils.h"
 #include "gom-gdata-miner.h"
 
@@ -35,10 +40,79 @@
 #define PREFIX_DRIVE "google:drive:"
 #define PREFIX_PICASAWEB "google:picasaweb:"
 
-static const guint MAX_RESULTS = 50;
+/* bounds for the adaptive page size, see page_sizer_update */
+static const guint PAGE_SIZE_INITIAL = 50;
+static const guint PAGE_SIZE_MIN = 10;
+static const guint PAGE_SIZE_MAX = 500;
+static const gint64 PAGE_TIME_TARGET = 2 * G_USEC_PER_SEC;
+static const guint PREFETCH_DEPTH = 2;
+static const gint MAX_ACL_FETCHES = 4;
+static const gint MAX_ALBUM_FETCHES = 4;
+static const gint MAX_SHARED_FETCHES = 4;
 
 G_DEFINE_TYPE (GomGDataMiner, gom_gdata_miner, GOM_TYPE_MINER)
 
+typedef struct {
+  const gchar *name;
+  guint size;
+} PageSizer;
+
+static void
+page_sizer_init (PageSizer *sizer,
+                 const gchar *name)
+{
+  sizer->name = name;
+  sizer->size = PAGE_SIZE_INITIAL;
+}
+
+static void
+page_sizer_set_size (PageSizer *sizer,
+                     guint size,
+                     gint64 elapsed)
+{
+  size = CLAMP (size, PAGE_SIZE_MIN, PAGE_SIZE_MAX);
+  if (size == sizer->size)
+    return;
+
+  g_debug ("Page size for %s: %u -> %u (last request took %" G_GINT64_FORMAT " ms)",
+           sizer->name, sizer->size, size, elapsed / 1000);
+  sizer->size = size;
+}
+
+/* Grows the page size while pages come back well within the target
+ * time, and halves it as soon as they take longer. libgdata does not
+ * expose the size of the payload, so the time it took to download and
+ * parse a page stands in for it.
+ */
+static void
+page_sizer_update (PageSizer *sizer,
+                   gint64 elapsed)
+{
+  if (elapsed > PAGE_TIME_TARGET)
+    page_sizer_set_size (sizer, sizer->size / 2, elapsed);
+  else if (elapsed < PAGE_TIME_TARGET / 2)
+    page_sizer_set_size (sizer, sizer->size * 2, elapsed);
+}
+
+/* Returns TRUE if the failed request should be retried with the new,
+ * smaller page size. Only a timeout says anything about the size of the
+ * page: other network errors are not retried, and libgdata does not
+ * expose the HTTP status of a failed request.
+ */
+static gboolean
+page_sizer_timed_out (PageSizer *sizer,
+                      const GError *error,
+                      gint64 elapsed)
+{
+  guint old_size = sizer->size;
+
+  if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+    return FALSE;
+
+  page_sizer_set_size (sizer, sizer->size / 2, elapsed);
+  return sizer->size < old_size;
+}
+
 static gchar *
 generate_fake_email_from_fullname (const gchar *fullname)
 {
@@ -58,8 +132,8 @@ static gboolean
 account_miner_job_process_entry (TrackerSparqlConnection *connection,
                                  GHashTable *previous_resources,
                                  const gchar *datasource_urn,
-                                 GDataDocumentsService *service,
                                  GDataDocumentsEntry *doc_entry,
+                                 gchar **changed_resource,
                                  GCancellable *cancellable,
                                  GError **error)
 {
@@ -68,7 +142,7 @@ account_miner_job_process_entry (TrackerSparqlConnection *connection,
   gchar *date, *identifier;
   const gchar *class = NULL;
   const gchar *mimetype_override = NULL;
-  gboolean mtime_changed, resource_exists;
+  gboolean mtime_changed = FALSE, resource_exists;
   gint64 new_mtime;
 
   GList *authors, *l, *parents = NULL;
@@ -82,8 +156,6 @@ account_miner_job_process_entry (TrackerSparqlConnection *connection,
   GDataCategory *category;
   gboolean starred = FALSE;
 
-  GDataFeed *access_rules = NULL;
-
   if (GDATA_IS_DOCUMENTS_FOLDER (doc_entry))
     {
       GDataLink *link;
@@ -127,7 +199,7 @@ account_miner_job_process_entry (TrackerSparqlConnection *connection,
     goto out;
 
   gom_tracker_update_datasource (connection, datasource_urn,
-                                 resource_exists, identifier, resource,
+                                 resource_exists, resource,
                                  cancellable, error);
 
   if (*error != NULL)
@@ -135,7 +207,7 @@ account_miner_job_process_entry (TrackerSparqlConnection *connection,
 
   new_mtime = gdata_entry_get_updated (entry);
   mtime_changed = gom_tracker_update_mtime (connection, new_mtime,
-                                            resource_exists, identifier, resource,
+                                            resource_exists, datasource_urn, resource,
                                             cancellable, error);
 
   if (*error != NULL)
@@ -251,6 +323,7 @@ account_miner_job_process_entry (TrackerSparqlConnection *connection,
 
       contact_resource = gom_tracker_utils_ensure_contact_resource (connection,
                                                                     cancellable, error,
+                                                                    datasource_urn,
                                                                     gdata_author_get_email_address (author),
                                                                     gdata_author_get_name (author));
 
@@ -269,13 +342,45 @@ account_miner_job_process_entry (TrackerSparqlConnection *connection,
       g_free (contact_resource);
     }
 
-  access_rules = gdata_access_handler_get_rules (GDATA_ACCESS_HANDLER (entry),
-                                                 GDATA_SERVICE (service),
-                                                 cancellable,
-                                                 NULL, NULL, error);
+  date = gom_iso8601_from_timestamp (gdata_entry_get_published (entry));
+  gom_tracker_sparql_connection_insert_or_replace_triple
+    (connection,
+     cancellable, error,
+     datasource_urn, resource,
+     "nie:contentCreated", date);
+  g_free (date);
+
+  if (*error != NULL)
+    goto out;
+
+ out:
+  /* the access rules are fetched separately, see query_gdata_documents */
+  if (*error == NULL && mtime_changed && changed_resource != NULL)
+    {
+      *changed_resource = resource;
+      resource = NULL;
+    }
+
+  g_free (resource);
+  g_free (identifier);
+
+  g_list_free (parents);
 
   if (*error != NULL)
-      goto out;
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+account_miner_job_process_access_rules (TrackerSparqlConnection *connection,
+                                        const gchar *datasource_urn,
+                                        const gchar *resource,
+                                        GDataFeed *access_rules,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+  GList *l;
 
   for (l = gdata_feed_get_entries (access_rules); l != NULL; l = l->next)
     {
@@ -296,9 +401,13 @@ account_miner_job_process_entry (TrackerSparqlConnection *connection,
 
       contact_resource = gom_tracker_utils_ensure_contact_resource (connection,
                                                                     cancellable, error,
+                                                                    datasource_urn,
                                                                     scope_value,
                                                                     "");
 
+      if (*error != NULL)
+        return FALSE;
+
       gom_tracker_sparql_connection_insert_or_replace_triple
         (connection,
          cancellable, error,
@@ -308,26 +417,149 @@ account_miner_job_process_entry (TrackerSparqlConnection *connection,
       g_free (contact_resource);
 
       if (*error != NULL)
-        goto out;
+        return FALSE;
     }
 
-  date = gom_iso8601_from_timestamp (gdata_entry_get_published (entry));
-  gom_tracker_sparql_connection_insert_or_replace_triple
+  return TRUE;
+}
+
+typedef struct {
+  const gchar *url;
+  const gchar *description;
+  const gchar *mimetype;
+  const gchar *title;
+  const gchar *credit;
+  const gchar *make;
+  const gchar *model;
+  gdouble exposure;
+  gdouble focal_length;
+  gdouble fstop;
+  glong iso;
+  gboolean flash;
+  guint width;
+  guint height;
+  gint64 timestamp;
+} PhotoMetadata;
+
+static void
+photo_metadata_init (PhotoMetadata *metadata,
+                     GDataPicasaWebFile *photo)
+{
+  GDataEntry *entry = GDATA_ENTRY (photo);
+  GDataLink *alternate;
+  GList *media_contents;
+
+  alternate = gdata_entry_look_up_link (entry, GDATA_LINK_ALTERNATE);
+  media_contents = gdata_picasaweb_file_get_contents (photo);
+
+  metadata->url = gdata_link_get_uri (alternate);
+  metadata->description = gdata_entry_get_summary (entry);
+  metadata->mimetype = gdata_media_content_get_content_type (GDATA_MEDIA_CONTENT (media_contents->data));
+  metadata->title = gdata_entry_get_title (entry);
+  metadata->credit = gdata_picasaweb_file_get_credit (photo);
+  metadata->make = gdata_picasaweb_file_get_make (photo);
+  metadata->model = gdata_picasaweb_file_get_model (photo);
+  metadata->exposure = gdata_picasaweb_file_get_exposure (photo);
+  metadata->focal_length = gdata_picasaweb_file_get_focal_length (photo);
+  metadata->fstop = gdata_picasaweb_file_get_fstop (photo);
+  metadata->iso = gdata_picasaweb_file_get_iso (photo);
+  metadata->flash = gdata_picasaweb_file_get_flash (photo);
+  metadata->width = gdata_picasaweb_file_get_width (photo);
+  metadata->height = gdata_picasaweb_file_get_height (photo);
+  metadata->timestamp = gdata_picasaweb_file_get_timestamp (photo);
+}
+
+static void
+add_property (GPtrArray *properties,
+              const gchar *name,
+              const gchar *value)
+{
+  g_ptr_array_add (properties, (gpointer) name);
+  g_ptr_array_add (properties, (gpointer) value);
+}
+
+static gboolean
+account_miner_job_write_photo_metadata (TrackerSparqlConnection *connection,
+                                        const gchar *datasource_urn,
+                                        const gchar *resource,
+                                        const gchar *parent_resource_urn,
+                                        PhotoMetadata *metadata,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+  GPtrArray *properties;
+  gchar *contact_resource = NULL, *equipment_resource = NULL;
+  gchar *date = NULL, *email;
+  gchar exposure[G_ASCII_DTOSTR_BUF_SIZE];
+  gchar focal_length[G_ASCII_DTOSTR_BUF_SIZE];
+  gchar fstop[G_ASCII_DTOSTR_BUF_SIZE];
+  gchar iso[32], width[16], height[16];
+
+  const gchar *flash_off = "http://www.tracker-project.org/temp/nmm#flash-off";
+  const gchar *flash_on = "http://www.tracker-project.org/temp/nmm#flash-on";
+
+  properties = g_ptr_array_new ();
+
+  email = generate_fake_email_from_fullname (metadata->credit);
+  contact_resource = gom_tracker_utils_ensure_contact_resource
     (connection,
      cancellable, error,
-     datasource_urn, resource,
-     "nie:contentCreated", date);
-  g_free (date);
+     datasource_urn,
+     email, metadata->credit);
+  g_free (email);
 
   if (*error != NULL)
     goto out;
 
- out:
-  g_clear_object (&access_rules);
-  g_free (resource);
-  g_free (identifier);
+  if (metadata->make != NULL || metadata->model != NULL)
+    {
+      equipment_resource = gom_tracker_utils_ensure_equipment_resource (connection,
+                                                                        cancellable,
+                                                                        error,
+                                                                        metadata->make,
+                                                                        metadata->model);
 
-  g_list_free (parents);
+      if (*error != NULL)
+        goto out;
+    }
+
+  g_ascii_formatd (exposure, sizeof (exposure), "%f", metadata->exposure);
+  g_ascii_formatd (focal_length, sizeof (focal_length), "%f", metadata->focal_length);
+  g_ascii_formatd (fstop, sizeof (fstop), "%f", metadata->fstop);
+  g_snprintf (iso, sizeof (iso), "%ld", metadata->iso);
+  g_snprintf (width, sizeof (width), "%u", metadata->width);
+  g_snprintf (height, sizeof (height), "%u", metadata->height);
+  date = gom_iso8601_from_timestamp (metadata->timestamp / 1000);
+
+  add_property (properties, "nie:url", metadata->url);
+  add_property (properties, "nie:description", metadata->description);
+  if (parent_resource_urn != NULL)
+    add_property (properties, "nie:isPartOf", parent_resource_urn);
+  add_property (properties, "nie:mimeType", metadata->mimetype);
+  add_property (properties, "nie:title", metadata->title);
+  add_property (properties, "nco:creator", contact_resource);
+  add_property (properties, "nmm:exposureTime", exposure);
+  add_property (properties, "nmm:focalLength", focal_length);
+  add_property (properties, "nmm:fnumber", fstop);
+  add_property (properties, "nmm:isoSpeed", iso);
+  add_property (properties, "nmm:flash", metadata->flash ? flash_on : flash_off);
+  if (equipment_resource != NULL)
+    add_property (properties, "nfo:equipment", equipment_resource);
+  add_property (properties, "nfo:width", width);
+  add_property (properties, "nfo:height", height);
+  add_property (properties, "nie:contentCreated", date);
+
+  gom_tracker_sparql_connection_insert_or_replace_properties
+    (connection,
+     cancellable, error,
+     datasource_urn, resource,
+     properties);
+
+ out:
+  g_ptr_array_unref (properties);
+  g_free (contact_resource);
+  g_free (equipment_resource);
+  g_free (date);
 
   if (*error != NULL)
     return FALSE;
@@ -345,34 +577,11 @@ account_miner_job_process_photo (TrackerSparqlConnection *connection,
                                  GError **error)
 {
   GList *l, *media_contents;
-  gchar *resource = NULL, *equipment_resource = NULL;
-  gchar *contact_resource, *date, *identifier = NULL;
+  gchar *resource = NULL, *identifier = NULL;
   gboolean resource_exists, mtime_changed;
   gint64 new_mtime;
-  gint64 timestamp;
-
-  const gchar *flash_off = "http://www.tracker-project.org/temp/nmm#flash-off";
-  const gchar *flash_on = "http://www.tracker-project.org/temp/nmm#flash-on";
-
-  gboolean flash;
-  const gchar *credit;
   const gchar *id;
-  const gchar *make;
-  const gchar *model;
-  const gchar *title;
-  const gchar *summary;
-  const gchar *mime;
-
-  gchar *email;
-  gchar *exposure;
-  gchar *focal_length;
-  gchar *fstop;
-  gchar *iso;
-  gchar *width;
-  gchar *height;
-
-  GDataLink *alternate;
-  const gchar *alternate_uri;
+  PhotoMetadata metadata;
 
   id = gdata_entry_get_id (GDATA_ENTRY (photo));
 
@@ -407,7 +616,7 @@ account_miner_job_process_photo (TrackerSparqlConnection *connection,
     goto out;
 
   gom_tracker_update_datasource (connection, datasource_urn,
-                                 resource_exists, identifier, resource,
+                                 resource_exists, resource,
                                  cancellable, error);
   if (*error != NULL)
     goto out;
@@ -417,7 +626,7 @@ account_miner_job_process_photo (TrackerSparqlConnection *connection,
    */
   new_mtime = gdata_entry_get_updated (GDATA_ENTRY (photo));
   mtime_changed = gom_tracker_update_mtime (connection, new_mtime,
-                                            resource_exists, identifier, resource,
+                                            resource_exists, datasource_urn, resource,
                                             cancellable, error);
 
   if (*error != NULL)
@@ -430,422 +639,205 @@ account_miner_job_process_photo (TrackerSparqlConnection *connection,
     goto out;
 
   /* the resource changed - just set all the properties again */
-  alternate = gdata_entry_look_up_link (GDATA_ENTRY (photo), GDATA_LINK_ALTERNATE);
-  alternate_uri = gdata_link_get_uri (alternate);
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nie:url", alternate_uri);
+  photo_metadata_init (&metadata, photo);
+  account_miner_job_write_photo_metadata (connection,
+                                          datasource_urn,
+                                          resource,
+                                          parent_resource_urn,
+                                          &metadata,
+                                          cancellable,
+                                          error);
+
+ out:
+  g_free (identifier);
 
   if (*error != NULL)
-    goto out;
+    return NULL;
 
-  summary = gdata_entry_get_summary ((GDATA_ENTRY (photo)));
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nie:description", summary);
+  return resource;
+}
 
-  if (*error != NULL)
-    goto out;
+static gchar *
+account_miner_job_process_album (TrackerSparqlConnection *connection,
+                                 GHashTable *previous_resources,
+                                 const gchar *datasource_urn,
+                                 GDataPicasaWebAlbum *album,
+                                 GCancellable *cancellable,
+                                 GError **error)
+{
+  gchar *resource = NULL;
+  gchar *contact_resource, *date, *identifier;
+  gchar *email;
+  gboolean resource_exists, mtime_changed;
+  gint64 new_mtime;
+  gint64 timestamp;
 
-  if (parent_resource_urn != NULL)
-    {
-      gom_tracker_sparql_connection_insert_or_replace_triple
-        (connection,
-         cancellable, error,
-         datasource_urn, resource,
-         "nie:isPartOf", parent_resource_urn);
+  const gchar *album_id;
+  const gchar *nickname;
+  const gchar *title;
+  const gchar *summary;
 
-      if (*error != NULL)
-        goto out;
-    }
+  GDataLink *alternate;
+  const gchar *alternate_uri;
 
-  mime = gdata_media_content_get_content_type (GDATA_MEDIA_CONTENT (media_contents->data));
-  gom_tracker_sparql_connection_insert_or_replace_triple
+  album_id = gdata_entry_get_id (GDATA_ENTRY (album));
+  identifier = g_strdup_printf ("photos:collection:%s%s", PREFIX_PICASAWEB, album_id);
+
+  /* remove from the list of the previous resources, if any */
+  if (previous_resources != NULL)
+    g_hash_table_remove (previous_resources, identifier);
+
+  resource = gom_tracker_sparql_connection_ensure_resource
     (connection,
      cancellable, error,
-     datasource_urn, resource,
-     "nie:mimeType", mime);
+     &resource_exists,
+     datasource_urn, identifier,
+     "nfo:RemoteDataObject", "nfo:DataContainer",
+     NULL);
 
   if (*error != NULL)
     goto out;
 
-  title = gdata_entry_get_title ((GDATA_ENTRY (photo)));
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nie:title", title);
+  gom_tracker_update_datasource
+    (connection, datasource_urn,
+     resource_exists, resource,
+     cancellable, error);
 
   if (*error != NULL)
     goto out;
 
-  credit = gdata_picasaweb_file_get_credit (photo);
-  email = generate_fake_email_from_fullname (credit);
-  contact_resource = gom_tracker_utils_ensure_contact_resource
-    (connection,
-     cancellable, error,
-     email, credit);
-  g_free (email);
+  /* Check updated time to avoid updating the DB if it has not
+   * been modified since our last run
+   */
+  new_mtime = gdata_entry_get_updated (GDATA_ENTRY (album));
+  mtime_changed = gom_tracker_update_mtime (connection, new_mtime,
+                                            resource_exists, datasource_urn, resource,
+                                            cancellable, error);
 
   if (*error != NULL)
     goto out;
 
+  /* avoid updating the DB if the resource already exists and has not
+   * been modified since our last run.
+   */
+  if (!mtime_changed)
+    goto out;
+
+  /* the resource changed - just set all the properties again */
+  alternate = gdata_entry_look_up_link (GDATA_ENTRY (album), GDATA_LINK_ALTERNATE);
+  alternate_uri = gdata_link_get_uri (alternate);
   gom_tracker_sparql_connection_insert_or_replace_triple
     (connection,
      cancellable, error,
      datasource_urn, resource,
-     "nco:creator", contact_resource);
+     "nie:url", alternate_uri);
 
-  g_free (contact_resource);
   if (*error != NULL)
     goto out;
 
-  exposure = g_strdup_printf ("%f", gdata_picasaweb_file_get_exposure (photo));
+  summary = gdata_entry_get_summary ((GDATA_ENTRY (album)));
   gom_tracker_sparql_connection_insert_or_replace_triple
     (connection,
      cancellable, error,
      datasource_urn, resource,
-     "nmm:exposureTime", exposure);
-  g_free (exposure);
+     "nie:description", summary);
 
   if (*error != NULL)
     goto out;
 
-  focal_length = g_strdup_printf ("%f", gdata_picasaweb_file_get_focal_length (photo));
+  title = gdata_entry_get_title ((GDATA_ENTRY (album)));
   gom_tracker_sparql_connection_insert_or_replace_triple
     (connection,
      cancellable, error,
      datasource_urn, resource,
-     "nmm:focalLength", focal_length);
-  g_free (focal_length);
+     "nie:title", title);
 
   if (*error != NULL)
     goto out;
 
-  fstop = g_strdup_printf ("%f", gdata_picasaweb_file_get_fstop (photo));
-  gom_tracker_sparql_connection_insert_or_replace_triple
+  nickname = gdata_picasaweb_album_get_nickname (album);
+  email = generate_fake_email_from_fullname (nickname);
+  contact_resource = gom_tracker_utils_ensure_contact_resource
     (connection,
      cancellable, error,
-     datasource_urn, resource,
-     "nmm:fnumber", fstop);
-  g_free (fstop);
+     datasource_urn,
+     email, nickname);
+  g_free (email);
 
   if (*error != NULL)
     goto out;
 
-  iso = g_strdup_printf ("%ld", (glong) gdata_picasaweb_file_get_iso (photo));
   gom_tracker_sparql_connection_insert_or_replace_triple
     (connection,
      cancellable, error,
      datasource_urn, resource,
-     "nmm:isoSpeed", iso);
-  g_free (iso);
+     "nco:creator", contact_resource);
+  g_free (contact_resource);
 
   if (*error != NULL)
     goto out;
 
-  flash = gdata_picasaweb_file_get_flash (photo);
+  timestamp = gdata_picasaweb_album_get_timestamp (album);
+  date = gom_iso8601_from_timestamp (timestamp / 1000);
   gom_tracker_sparql_connection_insert_or_replace_triple
     (connection,
      cancellable, error,
      datasource_urn, resource,
-     "nmm:flash", flash ? flash_on : flash_off);
+     "nie:contentCreated", date);
+  g_free (date);
 
   if (*error != NULL)
     goto out;
 
-  make = gdata_picasaweb_file_get_make (photo);
-  model = gdata_picasaweb_file_get_model (photo);
+ out:
+  g_free (identifier);
 
-  if (make != NULL || model != NULL)
+  if (*error != NULL)
     {
-      equipment_resource = gom_tracker_utils_ensure_equipment_resource (connection,
-                                                                        cancellable,
-                                                                        error,
-                                                                        make,
-                                                                        model);
+      g_free (resource);
+      return NULL;
+    }
 
-      if (*error != NULL)
-        goto out;
+  return resource;
+}
 
-      gom_tracker_sparql_connection_insert_or_replace_triple
-        (connection,
-         cancellable, error,
-         datasource_urn, resource,
-         "nfo:equipment", equipment_resource);
-
-      if (*error != NULL)
-        goto out;
-    }
-
-  width = g_strdup_printf ("%u", gdata_picasaweb_file_get_width (photo));
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nfo:width", width);
-  g_free (width);
-
-  if (*error != NULL)
-    goto out;
-
-  height = g_strdup_printf ("%u", gdata_picasaweb_file_get_height (photo));
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nfo:height", height);
-  g_free (height);
-
-  if (*error != NULL)
-    goto out;
-
-  timestamp = gdata_picasaweb_file_get_timestamp (photo);
-  date = gom_iso8601_from_timestamp (timestamp / 1000);
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nie:contentCreated", date);
-  g_free (date);
-
-  if (*error != NULL)
-    goto out;
-
- out:
-  g_free (identifier);
-  g_free (equipment_resource);
-
-  if (*error != NULL)
-    return NULL;
-
-  return resource;
-}
-
-static gboolean
-account_miner_job_process_album (TrackerSparqlConnection *connection,
-                                 GHashTable *previous_resources,
-                                 const gchar *datasource_urn,
-                                 GDataPicasaWebService *service,
-                                 GDataPicasaWebAlbum *album,
-                                 GCancellable *cancellable,
-                                 GError **error)
-{
-  GDataFeed *feed = NULL;
-  GDataPicasaWebQuery *query;
-  gchar *resource = NULL;
-  gchar *contact_resource, *date, *identifier;
-  gchar *email;
-  gboolean resource_exists, mtime_changed;
-  gint64 new_mtime;
-  gint64 timestamp;
-
-  const gchar *album_id;
-  const gchar *nickname;
-  const gchar *title;
-  const gchar *summary;
-
-  GList *l, *photos = NULL;
-
-  GDataLink *alternate;
-  const gchar *alternate_uri;
-
-  album_id = gdata_entry_get_id (GDATA_ENTRY (album));
-  identifier = g_strdup_printf ("photos:collection:%s%s", PREFIX_PICASAWEB, album_id);
-
-  /* remove from the list of the previous resources, if any */
-  if (previous_resources != NULL)
-    g_hash_table_remove (previous_resources, identifier);
-
-  resource = gom_tracker_sparql_connection_ensure_resource
-    (connection,
-     cancellable, error,
-     &resource_exists,
-     datasource_urn, identifier,
-     "nfo:RemoteDataObject", "nfo:DataContainer",
-     NULL);
-
-  if (*error != NULL)
-    goto out;
-
-  gom_tracker_update_datasource
-    (connection, datasource_urn,
-     resource_exists, identifier, resource,
-     cancellable, error);
-
-  if (*error != NULL)
-    goto out;
-
-  /* Check updated time to avoid updating the DB if it has not
-   * been modified since our last run
-   */
-  new_mtime = gdata_entry_get_updated (GDATA_ENTRY (album));
-  mtime_changed = gom_tracker_update_mtime (connection, new_mtime,
-                                            resource_exists, identifier, resource,
-                                            cancellable, error);
-
-  if (*error != NULL)
-    goto out;
-
-  /* avoid updating the DB if the resource already exists and has not
-   * been modified since our last run.
-   */
-  if (!mtime_changed)
-    goto album_photos;
-
-  /* the resource changed - just set all the properties again */
-  alternate = gdata_entry_look_up_link (GDATA_ENTRY (album), GDATA_LINK_ALTERNATE);
-  alternate_uri = gdata_link_get_uri (alternate);
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nie:url", alternate_uri);
-
-  if (*error != NULL)
-    goto out;
-
-  summary = gdata_entry_get_summary ((GDATA_ENTRY (album)));
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nie:description", summary);
-
-  if (*error != NULL)
-    goto out;
-
-  title = gdata_entry_get_title ((GDATA_ENTRY (album)));
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nie:title", title);
-
-  if (*error != NULL)
-    goto out;
-
-  nickname = gdata_picasaweb_album_get_nickname (album);
-  email = generate_fake_email_from_fullname (nickname);
-  contact_resource = gom_tracker_utils_ensure_contact_resource
-    (connection,
-     cancellable, error,
-     email, nickname);
-  g_free (email);
-
-  if (*error != NULL)
-    goto out;
-
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nco:creator", contact_resource);
-  g_free (contact_resource);
-
-  if (*error != NULL)
-    goto out;
-
-  timestamp = gdata_picasaweb_album_get_timestamp (album);
-  date = gom_iso8601_from_timestamp (timestamp / 1000);
-  gom_tracker_sparql_connection_insert_or_replace_triple
-    (connection,
-     cancellable, error,
-     datasource_urn, resource,
-     "nie:contentCreated", date);
-  g_free (date);
-
-  if (*error != NULL)
-    goto out;
-
- album_photos:
-  query = gdata_picasaweb_query_new (NULL);
-  gdata_picasaweb_query_set_image_size (query, "d");
-  feed = gdata_picasaweb_service_query_files (service, album, GDATA_QUERY (query),
-                                              cancellable, NULL, NULL, error);
-
-  g_object_unref (query);
-
-  if (feed == NULL)
-    goto out;
-
-  photos = gdata_feed_get_entries (feed);
-  for (l = photos; l != NULL; l = l->next)
-    {
-      GDataPicasaWebFile *file = GDATA_PICASAWEB_FILE (l->data);
-      gchar *photo_resource_urn = NULL;
-
-      photo_resource_urn = account_miner_job_process_photo (connection,
-                                                            previous_resources,
-                                                            datasource_urn,
-                                                            file,
-                                                            resource,
-                                                            cancellable,
-                                                            error);
-
-      if (*error != NULL)
-        {
-          const gchar *photo_id;
-
-          photo_id = gdata_picasaweb_file_get_id (file);
-          g_warning ("Unable to process photo %s: %s", photo_id, (*error)->message);
-          g_clear_error (error);
-        }
-
-      g_free (photo_resource_urn);
-    }
-
- out:
-  g_clear_object (&feed);
-  g_free (resource);
-  g_free (identifier);
-
-  if (*error != NULL)
-    return FALSE;
-
-  return TRUE;
-}
-
-static void
-insert_shared_content_photos (TrackerSparqlConnection *connection,
-                              const gchar *datasource_urn,
-                              const gchar *shared_id,
-                              const gchar *source_urn,
-                              GDataPicasaWebService *service,
-                              GCancellable *cancellable,
-                              GError **error)
+static gpointer
+fetch_shared_photo (GDataPicasaWebService *service,
+                    const gchar *shared_id,
+                    GCancellable *cancellable,
+                    GError **error)
 {
-  GError *local_error;
   GDataAuthorizationDomain *authorization_domain;
-  GDataEntry *entry = NULL;
-  GDataPicasaWebFile *file;
-  GDataPicasaWebQuery *query = NULL;
-  gchar *photo_resource_urn = NULL;
+  GDataEntry *entry;
+  GDataPicasaWebQuery *query;
 
   authorization_domain = gdata_picasaweb_service_get_primary_authorization_domain ();
 
   query = gdata_picasaweb_query_new (NULL);
   gdata_picasaweb_query_set_image_size (query, "d");
 
-  local_error = NULL;
   entry = gdata_service_query_single_entry (GDATA_SERVICE (service),
                                             authorization_domain,
                                             shared_id,
                                             GDATA_QUERY (query),
                                             GDATA_TYPE_PICASAWEB_FILE,
                                             cancellable,
-                                            &local_error);
-  if (local_error != NULL)
-    {
-      g_propagate_error (error, local_error);
-      goto out;
-    }
+                                            error);
 
-  file = GDATA_PICASAWEB_FILE (entry);
+  g_object_unref (query);
+  return entry;
+}
+
+static void
+account_miner_job_process_shared_photo (TrackerSparqlConnection *connection,
+                                        const gchar *datasource_urn,
+                                        GDataPicasaWebFile *file,
+                                        const gchar *source_urn,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+  GError *local_error;
+  gchar *photo_resource_urn = NULL;
 
   local_error = NULL;
   photo_resource_urn = account_miner_job_process_photo (connection,
@@ -888,11 +880,44 @@ insert_shared_content_photos (TrackerSparqlConnection *connection,
     }
 
  out:
-  g_clear_object (&entry);
-  g_clear_object (&query);
   g_free (photo_resource_urn);
 }
 
+static void
+insert_shared_content_photos (TrackerSparqlConnection *connection,
+                              const gchar *datasource_urn,
+                              const gchar *shared_id,
+                              const gchar *source_urn,
+                              GDataPicasaWebService *service,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+  GDataEntry *entry;
+
+  entry = fetch_shared_photo (service, shared_id, cancellable, error);
+  if (entry == NULL)
+    return;
+
+  account_miner_job_process_shared_photo (connection,
+                                          datasource_urn,
+                                          GDATA_PICASAWEB_FILE (entry),
+                                          source_urn,
+                                          cancellable,
+                                          error);
+  g_object_unref (entry);
+}
+
+static gpointer
+fetch_shared_item (gpointer item,
+                   gpointer user_data,
+                   GCancellable *cancellable,
+                   GError **error)
+{
+  GomSharedContentItem *shared_item = item;
+
+  return fetch_shared_photo (GDATA_PICASAWEB_SERVICE (user_data), shared_item->shared_id, cancellable, error);
+}
+
 static void
 insert_shared_content (GomMiner *miner,
                        gpointer service,
@@ -914,6 +939,202 @@ insert_shared_content (GomMiner *miner,
                                   error);
 }
 
+/* The entries are fetched concurrently, and queued by this thread as
+ * they arrive, to be written together once they are all in. The graph
+ * already has the account's resources, so they are still looked up.
+ */
+static void
+insert_shared_content_batch (GomMiner *miner,
+                             gpointer service,
+                             TrackerSparqlConnection *connection,
+                             const gchar *datasource_urn,
+                             const gchar *shared_type,
+                             GPtrArray *items,
+                             GCancellable *cancellable,
+                             GError **error)
+{
+  GomFetchPool *pool;
+  GomSharedContentItem *item;
+  GomTrackerBatch *batch;
+  GDataEntry *entry;
+  GError *local_error = NULL;
+  guint idx;
+
+  if (g_strcmp0 (shared_type, "photos") != 0)
+    return;
+
+  batch = gom_tracker_batch_new_with_lookups (connection, cancellable);
+
+  pool = gom_fetch_pool_new (MAX_SHARED_FETCHES,
+                             fetch_shared_item, service,
+                             NULL, g_object_unref,
+                             cancellable);
+
+  for (idx = 0; idx < items->len; idx++)
+    gom_fetch_pool_push (pool, g_ptr_array_index (items, idx));
+
+  gom_tracker_batch_push_thread_default (batch);
+
+  while (gom_fetch_pool_pop (pool, (gpointer *) &item, (gpointer *) &entry, &local_error))
+    {
+      if (local_error == NULL)
+        {
+          account_miner_job_process_shared_photo (connection,
+                                                  datasource_urn,
+                                                  GDATA_PICASAWEB_FILE (entry),
+                                                  item->source_urn,
+                                                  cancellable,
+                                                  &local_error);
+          g_object_unref (entry);
+        }
+
+      if (local_error != NULL)
+        {
+          g_warning ("Unable to insert shared content %s: %s", item->shared_id, local_error->message);
+
+          if (*error == NULL)
+            g_propagate_error (error, local_error);
+          else
+            g_error_free (local_error);
+
+          local_error = NULL;
+        }
+    }
+
+  gom_tracker_batch_pop_thread_default (batch);
+  gom_fetch_pool_free (pool);
+
+  if (!gom_tracker_batch_flush (batch, &local_error))
+    {
+      g_warning ("Unable to insert shared content: %s", local_error->message);
+
+      if (*error == NULL)
+        g_propagate_error (error, local_error);
+      else
+        g_error_free (local_error);
+    }
+
+  gom_tracker_batch_free (batch);
+}
+
+typedef struct {
+  GDataDocumentsService *service;
+  GDataDocumentsQuery *query;
+  PageSizer sizer;
+} DocumentsPager;
+
+static guint
+get_prefetch_depth (void)
+{
+  const gchar *str;
+  guint64 depth;
+
+  str = g_getenv ("GDATA_MINER_PREFETCH_DEPTH");
+  if (str == NULL)
+    return PREFETCH_DEPTH;
+
+  depth = g_ascii_strtoull (str, NULL, 10);
+  if (depth == 0 || depth > G_MAXUINT)
+    {
+      g_warning ("Invalid prefetch depth %s, using %u", str, PREFETCH_DEPTH);
+      return PREFETCH_DEPTH;
+    }
+
+  return (guint) depth;
+}
+
+/* Runs in the pager's thread, so it is the only one touching the query
+ * once the pager has been started.
+ */
+static gpointer
+fetch_documents_page (gpointer user_data,
+                      GCancellable *cancellable,
+                      GError **error)
+{
+  DocumentsPager *data = user_data;
+  GDataDocumentsFeed *feed;
+
+  while (TRUE)
+    {
+      GError *local_error = NULL;
+      gint64 start, elapsed;
+
+      gdata_query_set_max_results (GDATA_QUERY (data->query), data->sizer.size);
+
+      start = g_get_monotonic_time ();
+      feed = gdata_documents_service_query_documents
+        (data->service, data->query,
+         cancellable, NULL, NULL, &local_error);
+      elapsed = g_get_monotonic_time () - start;
+
+      if (feed != NULL)
+        {
+          page_sizer_update (&data->sizer, elapsed);
+          break;
+        }
+
+      if (!page_sizer_timed_out (&data->sizer, local_error, elapsed))
+        {
+          g_propagate_error (error, local_error);
+          return NULL;
+        }
+
+      g_error_free (local_error);
+    }
+
+  if (gdata_feed_get_entries (GDATA_FEED (feed)) == NULL)
+    {
+      g_object_unref (feed);
+      return NULL;
+    }
+
+  gdata_query_next_page (GDATA_QUERY (data->query));
+  return feed;
+}
+
+typedef struct {
+  GDataEntry *entry;
+  gchar *resource;
+} AccessRulesFetch;
+
+static AccessRulesFetch *
+access_rules_fetch_new (GDataEntry *entry,
+                        gchar *resource)
+{
+  AccessRulesFetch *fetch;
+
+  fetch = g_slice_new0 (AccessRulesFetch);
+  fetch->entry = g_object_ref (entry);
+  fetch->resource = resource;
+
+  return fetch;
+}
+
+static void
+access_rules_fetch_free (gpointer data)
+{
+  AccessRulesFetch *fetch = data;
+
+  g_object_unref (fetch->entry);
+  g_free (fetch->resource);
+  g_slice_free (AccessRulesFetch, fetch);
+}
+
+static gpointer
+fetch_access_rules (gpointer item,
+                    gpointer user_data,
+                    GCancellable *cancellable,
+                    GError **error)
+{
+  AccessRulesFetch *fetch = item;
+  GDataService *service = GDATA_SERVICE (user_data);
+
+  return gdata_access_handler_get_rules (GDATA_ACCESS_HANDLER (fetch->entry),
+                                         service,
+                                         cancellable,
+                                         NULL, NULL, error);
+}
+
 static void
 query_gdata_documents (GomAccountMinerJob *job,
                        TrackerSparqlConnection *connection,
@@ -923,22 +1144,40 @@ query_gdata_documents (GomAccountMinerJob *job,
                        GCancellable *cancellable,
                        GError **error)
 {
-  GDataDocumentsQuery *query = NULL;
+  DocumentsPager data;
+  GomPager *pager;
+  GomFetchPool *acl_pool;
   GDataDocumentsFeed *feed = NULL;
   GList *entries, *l;
   gboolean succeeded_once = FALSE;
 
-  query = gdata_documents_query_new_with_limits (NULL, 1, MAX_RESULTS);
-  gdata_documents_query_set_show_folders (query, TRUE);
+  data.service = service;
+  data.query = gdata_documents_query_new_with_limits (NULL, 1, PAGE_SIZE_INITIAL);
+  page_sizer_init (&data.sizer, "documents");
+  gdata_documents_query_set_show_folders (data.query, TRUE);
+
+  /* the next pages are requested while the current one is being
+   * written, but they are still processed in order.
+   */
+  pager = gom_pager_new (get_prefetch_depth (),
+                         fetch_documents_page,
+                         &data,
+                         g_object_unref,
+                         cancellable);
+
+  acl_pool = gom_fetch_pool_new (MAX_ACL_FETCHES,
+                                 fetch_access_rules,
+                                 service,
+                                 access_rules_fetch_free,
+                                 g_object_unref,
+                                 cancellable);
 
   while (TRUE)
     {
       GError *local_error;
 
       local_error = NULL;
-      feed = gdata_documents_service_query_documents
-        (service, query,
-         cancellable, NULL, NULL, &local_error);
+      feed = gom_pager_next (pager, &local_error);
       if (local_error != NULL)
         {
           if (succeeded_once)
@@ -954,37 +1193,151 @@ query_gdata_documents (GomAccountMinerJob *job,
           break;
         }
 
+      if (feed == NULL)
+        break;
+
       succeeded_once = TRUE;
 
       entries = gdata_feed_get_entries (GDATA_FEED (feed));
-      if (entries == NULL)
-        break;
-
       for (l = entries; l != NULL; l = l->next)
         {
+          gchar *changed_resource = NULL;
+          gint64 trace;
+
           local_error = NULL;
+          trace = gom_trace_begin ();
           account_miner_job_process_entry (connection,
                                            previous_resources,
                                            datasource_urn,
-                                           service,
                                            l->data,
+                                           &changed_resource,
                                            cancellable,
                                            &local_error);
+          gom_trace_end (trace, "entry", "entry");
 
           if (local_error != NULL)
             {
               g_warning ("Unable to process entry %p: %s", l->data, local_error->message);
               g_error_free (local_error);
             }
+
+          /* only entries modified since the last run need their
+           * access rules, the others already have their contributors.
+           */
+          if (changed_resource != NULL)
+            gom_fetch_pool_push (acl_pool, access_rules_fetch_new (l->data, changed_resource));
+        }
+
+      /* write the contributors of this page while the pager is busy
+       * with the next one.
+       */
+      while (TRUE)
+        {
+          AccessRulesFetch *fetch = NULL;
+          GDataFeed *access_rules = NULL;
+
+          local_error = NULL;
+          if (!gom_fetch_pool_pop (acl_pool, (gpointer *) &fetch, (gpointer *) &access_rules, &local_error))
+            break;
+
+          if (local_error == NULL)
+            account_miner_job_process_access_rules (connection,
+                                                    datasource_urn,
+                                                    fetch->resource,
+                                                    access_rules,
+                                                    cancellable,
+                                                    &local_error);
+
+          if (local_error != NULL)
+            {
+              g_warning ("Unable to process access rules for %s: %s", fetch->resource, local_error->message);
+              g_error_free (local_error);
+            }
+
+          g_clear_object (&access_rules);
+          access_rules_fetch_free (fetch);
         }
 
-      gdata_query_next_page (GDATA_QUERY (query));
       g_clear_object (&feed);
     }
 
- out:
-  g_clear_object (&feed);
-  g_clear_object (&query);
+  gom_fetch_pool_free (acl_pool);
+  gom_pager_free (pager);
+  g_clear_object (&data.query);
+}
+
+typedef struct {
+  GDataPicasaWebAlbum *album;
+  gchar *album_resource;
+  guint start_index;
+  guint page_size;
+
+  /* filled in by fetch_album_page */
+  GDataFeed *feed;
+  gint64 elapsed;
+} AlbumPage;
+
+static AlbumPage *
+album_page_new (GDataPicasaWebAlbum *album,
+                const gchar *album_resource,
+                guint start_index,
+                guint page_size)
+{
+  AlbumPage *page;
+
+  page = g_slice_new0 (AlbumPage);
+  page->album = g_object_ref (album);
+  page->album_resource = g_strdup (album_resource);
+  page->start_index = start_index;
+  page->page_size = page_size;
+
+  return page;
+}
+
+static void
+album_page_free (AlbumPage *page)
+{
+  g_object_unref (page->album);
+  g_free (page->album_resource);
+  g_clear_object (&page->feed);
+  g_slice_free (AlbumPage, page);
+}
+
+static gpointer
+fetch_album_page (gpointer item,
+                  gpointer user_data,
+                  GCancellable *cancellable,
+                  GError **error)
+{
+  AlbumPage *page = item;
+  GDataPicasaWebService *service = GDATA_PICASAWEB_SERVICE (user_data);
+  GDataPicasaWebQuery *query;
+  gint64 start;
+
+  query = gdata_picasaweb_query_new (NULL);
+  gdata_picasaweb_query_set_image_size (query, "d");
+  gdata_query_set_start_index (GDATA_QUERY (query), page->start_index);
+  gdata_query_set_max_results (GDATA_QUERY (query), page->page_size);
+
+  start = g_get_monotonic_time ();
+  page->feed = gdata_picasaweb_service_query_files (service, page->album, GDATA_QUERY (query),
+                                                    cancellable, NULL, NULL, error);
+  page->elapsed = g_get_monotonic_time () - start;
+
+  g_object_unref (query);
+
+  if (page->feed == NULL)
+    return NULL;
+
+  return page;
+}
+
+static gboolean
+is_picasaweb_resource (gpointer key,
+                       gpointer value,
+                       gpointer user_data)
+{
+  return strstr (key, PREFIX_PICASAWEB) != NULL;
 }
 
 static void
@@ -996,38 +1349,134 @@ query_gdata_photos (GomAccountMinerJob *job,
                     GCancellable *cancellable,
                     GError **error)
 {
+  GomFetchPool *pool;
   GDataFeed *feed;
   GList *albums, *l;
+  AlbumPage *page;
+  GError *local_error = NULL;
+  PageSizer sizer;
+  gboolean listing_failed = FALSE;
+
+  page_sizer_init (&sizer, "picasaweb");
 
   feed = gdata_picasaweb_service_query_all_albums (service, NULL, NULL, cancellable, NULL, NULL, error);
 
   if (feed == NULL)
     return;
 
+  /* the pages of several albums are fetched concurrently, and each page
+   * is written as soon as it arrives. The sizer is only touched from
+   * this thread: a page is requested with the size current at the time
+   * it is queued.
+   */
+  pool = gom_fetch_pool_new (MAX_ALBUM_FETCHES,
+                             fetch_album_page, service,
+                             (GDestroyNotify) album_page_free, NULL,
+                             cancellable);
+
   albums = gdata_feed_get_entries (feed);
   for (l = albums; l != NULL; l = l->next)
     {
       GDataPicasaWebAlbum *album = GDATA_PICASAWEB_ALBUM (l->data);
+      gchar *album_resource;
+      gint64 trace;
 
-      account_miner_job_process_album (connection,
-                                       previous_resources,
-                                       datasource_urn,
-                                       service,
-                                       album,
-                                       cancellable,
-                                       error);
+      trace = gom_trace_begin ();
+      album_resource = account_miner_job_process_album (connection,
+                                                        previous_resources,
+                                                        datasource_urn,
+                                                        album,
+                                                        cancellable,
+                                                        &local_error);
+      gom_trace_end (trace, "entry", "album");
 
-      if (*error != NULL)
+      if (local_error != NULL)
         {
           const gchar *album_id;
 
           album_id = gdata_picasaweb_album_get_id (album);
-          g_warning ("Unable to process album %s: %s", album_id, (*error)->message);
-          g_clear_error (error);
+          g_warning ("Unable to process album %s: %s", album_id, local_error->message);
+          g_clear_error (&local_error);
+          listing_failed = TRUE;
+          continue;
+        }
+
+      gom_fetch_pool_push (pool, album_page_new (album, album_resource, 1, sizer.size));
+      g_free (album_resource);
+    }
+
+  while (gom_fetch_pool_pop (pool, (gpointer *) &page, NULL, &local_error))
+    {
+      guint n_photos;
+
+      if (local_error != NULL)
+        {
+          if (page_sizer_timed_out (&sizer, local_error, page->elapsed))
+            {
+              gom_fetch_pool_push (pool, album_page_new (page->album, page->album_resource,
+                                                         page->start_index, sizer.size));
+            }
+          else
+            {
+              const gchar *album_id;
+
+              album_id = gdata_picasaweb_album_get_id (page->album);
+              g_warning ("Unable to fetch the photos of album %s: %s", album_id, local_error->message);
+              listing_failed = TRUE;
+            }
+
+          g_clear_error (&local_error);
+          album_page_free (page);
+          continue;
+        }
+
+      page_sizer_update (&sizer, page->elapsed);
+
+      /* a short page is the last one of its album */
+      n_photos = g_list_length (gdata_feed_get_entries (page->feed));
+      if (n_photos == page->page_size)
+        gom_fetch_pool_push (pool, album_page_new (page->album, page->album_resource,
+                                                   page->start_index + n_photos, sizer.size));
+
+      for (l = gdata_feed_get_entries (page->feed); l != NULL; l = l->next)
+        {
+          GDataPicasaWebFile *file = GDATA_PICASAWEB_FILE (l->data);
+          gchar *photo_resource_urn;
+          gint64 trace;
+
+          trace = gom_trace_begin ();
+          photo_resource_urn = account_miner_job_process_photo (connection,
+                                                                previous_resources,
+                                                                datasource_urn,
+                                                                file,
+                                                                page->album_resource,
+                                                                cancellable,
+                                                                &local_error);
+          gom_trace_end (trace, "entry", "photo");
+
+          if (local_error != NULL)
+            {
+              const gchar *photo_id;
+
+              photo_id = gdata_picasaweb_file_get_id (file);
+              g_warning ("Unable to process photo %s: %s", photo_id, local_error->message);
+              g_clear_error (&local_error);
+            }
+
+          g_free (photo_resource_urn);
         }
+
+      album_page_free (page);
     }
 
+  gom_fetch_pool_free (pool);
   g_object_unref (feed);
+
+  /* the photos of an album that was not fully listed are not gone; the
+   * documents are listed separately, and can still be deleted
+   */
+  if (listing_failed)
+    g_hash_table_foreach_remove (previous_resources, is_picasaweb_resource, NULL);
 }
 
 static void
@@ -1123,6 +1572,12 @@ gom_gdata_miner_init (GomGDataMiner *miner)
 {
 }
 
+/* 6: contacts are kept in the graph of their account */
+static const GomMinerMigration migrations[] = {
+  { 6, GOM_MINER_MIGRATION_CONTACTS_INTO_GRAPH, TRUE },
+  { 0, }
+};
+
 static void
 gom_gdata_miner_class_init (GomGDataMinerClass *klass)
 {
@@ -1130,11 +1585,13 @@ gom_gdata_miner_class_init (GomGDataMinerClass *klass)
 
   miner_class->goa_provider_type = "google";
   miner_class->miner_identifier = MINER_IDENTIFIER;
-  miner_class->version = 5;
+  miner_class->version = 6;
+  miner_class->migrations = migrations;
 
   miner_class->create_service = create_service;
   miner_class->create_services = create_services;
   miner_class->destroy_service = destroy_service;
   miner_class->insert_shared_content = insert_shared_content;
+  miner_class->insert_shared_content_batch = insert_shared_content_batch;
   miner_class->query = query_gdata;
 }
@@ -0,0 +1,141 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+/* Decides the CPU and I/O priority of each thread from the work it is
+ * doing: requests that someone is waiting on run at the normal priority,
+ * the rest in the idle classes, so that it does not get in the way of
+ * the applications.
+ *
+ * Both are per thread on Linux, and are inherited by the threads they
+ * spawn. Only the I/O priority can always be raised again; leaving
+ * SCHED_IDLE or lowering the nice value needs CAP_SYS_NICE or a large
+ * enough RLIMIT_NICE. Without those, threads that might later run
+ * interactive work are only given the idle I/O class, so crawls run in
+ * threads of their own that are demoted for good.
+ */
+
+#include "config.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "gom-governor.h"
+#include "tracker-ioprio.h"
+#include "tracker-sched.h"
+
+/* the GomGovernorLevel + 1 that was last applied to the thread, or
+ * DEMOTED
+ */
+static GPrivate level_key = G_PRIVATE_INIT (NULL);
+
+static const gint DEMOTED = -1;
+
+static gboolean can_leave_idle;
+
+static gpointer
+gom_governor_probe_thread_func (gpointer user_data)
+{
+  return GINT_TO_POINTER (tracker_sched_idle () && tracker_sched_normal ());
+}
+
+/* Meant to be called once from the main thread, before any other thread
+ * is running.
+ */
+void
+gom_governor_init (void)
+{
+  GThread *thread;
+
+  /* the probe is thrown away with its thread */
+  thread = g_thread_new ("gom-governor-probe", gom_governor_probe_thread_func, NULL);
+  can_leave_idle = GPOINTER_TO_INT (g_thread_join (thread));
+
+  g_debug ("Threads can%s leave SCHED_IDLE", can_leave_idle ? "" : "not");
+
+  /* D-Bus requests are dispatched by the main thread */
+  gom_governor_set_thread_level (GOM_GOVERNOR_LEVEL_INTERACTIVE);
+}
+
+/* Called by the thread itself before it starts on some work. */
+void
+gom_governor_set_thread_level (GomGovernorLevel level)
+{
+  gint current;
+
+  current = GPOINTER_TO_INT (g_private_get (&level_key));
+  if (current == DEMOTED || current == (gint) level + 1)
+    return;
+
+  switch (level)
+    {
+    case GOM_GOVERNOR_LEVEL_BACKGROUND:
+      if (can_leave_idle)
+        tracker_sched_idle ();
+      tracker_ioprio_init ();
+      break;
+
+    case GOM_GOVERNOR_LEVEL_INTERACTIVE:
+      if (!tracker_sched_normal ())
+        g_debug ("Unable to raise the scheduling class of this thread");
+      tracker_ioprio_normal ();
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  g_private_set (&level_key, GINT_TO_POINTER ((gint) level + 1));
+}
+
+static void
+gom_governor_nice_thread (void)
+{
+#ifdef __linux__
+  /* on Linux the nice value is per thread, and PRIO_PROCESS takes a
+   * thread id
+   */
+  if (setpriority (PRIO_PROCESS, (id_t) syscall (SYS_gettid), 19) != 0)
+    g_debug ("Unable to renice this thread: %s", g_strerror (errno));
+#endif
+}
+
+/* For threads that never run anything but background work, and are not
+ * shared with other thread pools: puts them in SCHED_IDLE and at nice 19
+ * for good, whether it can be undone or not. The nice value is what
+ * still applies if SCHED_IDLE is not available.
+ */
+void
+gom_governor_demote_thread (void)
+{
+  if (GPOINTER_TO_INT (g_private_get (&level_key)) == DEMOTED)
+    return;
+
+  tracker_sched_idle ();
+  gom_governor_nice_thread ();
+  tracker_ioprio_init ();
+
+  g_private_set (&level_key, GINT_TO_POINTER (DEMOTED));
+}
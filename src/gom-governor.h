@@ -0,0 +1,43 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+#ifndef __GOM_GOVERNOR_H__
+#define __GOM_GOVERNOR_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GOM_GOVERNOR_LEVEL_BACKGROUND,
+  GOM_GOVERNOR_LEVEL_INTERACTIVE
+} GomGovernorLevel;
+
+void gom_governor_init (void);
+
+void gom_governor_set_thread_level (GomGovernorLevel level);
+
+void gom_governor_demote_thread (void);
+
+G_END_DECLS
+
+#endif /* __GOM_GOVERNOR_H__ */
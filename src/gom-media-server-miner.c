@@ -28,6 +28,7 @@
 #include "gom-dlna-server.h"
 #include "gom-dlna-servers-manager.h"
 #include "gom-media-server-miner.h"
+#include "gom-trace.h"
 
 #define MINER_IDENTIFIER "gd:media-server:miner:a4a47a3e-eb55-11e3-b983-14feb59cfa0e"
 
@@ -72,7 +73,7 @@ account_miner_job_process_photo (GomAccountMinerJob *job,
     goto out;
 
   gom_tracker_update_datasource (connection, datasource_urn,
-                                 resource_exists, identifier, resource,
+                                 resource_exists, resource,
                                  cancellable, error);
   if (*error != NULL)
     goto out;
@@ -156,7 +157,9 @@ query_media_server (GomAccountMinerJob *job,
   for (l = photos_list; l != NULL; l = l->next)
     {
       GomDlnaPhotoItem *photo = (GomDlnaPhotoItem *) l->data;
+      gint64 trace;
 
+      trace = gom_trace_begin ();
       account_miner_job_process_photo (job,
                                        connection,
                                        previous_resources,
@@ -164,6 +167,7 @@ query_media_server (GomAccountMinerJob *job,
                                        photo,
                                        cancellable,
                                        &local_error);
+      gom_trace_end (trace, "entry", "photo");
       if (local_error != NULL)
         {
           g_warning ("Unable to process photo: %s", local_error->message);
@@ -0,0 +1,233 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+/* Runs several miners in a single process. Each of them still owns its
+ * own bus name and exports its own org.gnome.OnlineMiners.Miner object,
+ * but they share the GoaClient, the tracker connection, the cleanup
+ * thread pool and the URN cache.
+ */
+
+#include "config.h"
+
+#include <glib-unix.h>
+#include <glib.h>
+
+#include "gom-application.h"
+#include "gom-governor.h"
+#include "gom-recorder.h"
+#include "gom-trace.h"
+#include "gom-tracker.h"
+
+#ifdef GOM_HOST_FACEBOOK
+#include "gom-facebook-miner.h"
+#endif
+#ifdef GOM_HOST_FLICKR
+#include "gom-flickr-miner.h"
+#endif
+#ifdef GOM_HOST_GOOGLE
+#include "gom-gdata-miner.h"
+#endif
+#ifdef GOM_HOST_MEDIA_SERVER
+#include "gom-media-server-miner.h"
+#endif
+#ifdef GOM_HOST_OWNCLOUD
+#include "gom-owncloud-miner.h"
+#endif
+#ifdef GOM_HOST_WINDOWS_LIVE
+#include "gom-zpj-miner.h"
+#endif
+
+typedef struct {
+  const gchar *name;
+  const gchar *bus_name;
+  GType (*get_type) (void);
+} HostedMiner;
+
+static const HostedMiner hosted_miners[] = {
+#ifdef GOM_HOST_FACEBOOK
+  { "facebook", "org.gnome.OnlineMiners.Facebook", gom_facebook_miner_get_type },
+#endif
+#ifdef GOM_HOST_FLICKR
+  { "flickr", "org.gnome.OnlineMiners.Flickr", gom_flickr_miner_get_type },
+#endif
+#ifdef GOM_HOST_GOOGLE
+  { "gdata", "org.gnome.OnlineMiners.GData", gom_gdata_miner_get_type },
+#endif
+#ifdef GOM_HOST_MEDIA_SERVER
+  { "media-server", "org.gnome.OnlineMiners.MediaServer", gom_media_server_miner_get_type },
+#endif
+#ifdef GOM_HOST_OWNCLOUD
+  { "owncloud", "org.gnome.OnlineMiners.Owncloud", gom_owncloud_miner_get_type },
+#endif
+#ifdef GOM_HOST_WINDOWS_LIVE
+  { "zpj", "org.gnome.OnlineMiners.Zpj", gom_zpj_miner_get_type },
+#endif
+  { NULL, NULL, NULL }
+};
+
+static gchar **enabled_miners = NULL;
+
+static GOptionEntry entries[] = {
+  { "miner", 'm', 0, G_OPTION_ARG_STRING_ARRAY, &enabled_miners,
+    "Miner to host, can be repeated (default: all)", "NAME" },
+  { NULL }
+};
+
+static gboolean
+signal_handler_cb (gpointer user_data)
+{
+  GMainLoop *loop = user_data;
+
+  g_main_loop_quit (loop);
+  return FALSE;
+}
+
+static gboolean
+dump_stats_cb (gpointer user_data)
+{
+  gom_tracker_stats_dump ();
+  return TRUE;
+}
+
+static gboolean
+miner_is_enabled (const gchar *name)
+{
+  guint i;
+
+  if (enabled_miners == NULL)
+    return TRUE;
+
+  for (i = 0; enabled_miners[i] != NULL; i++)
+    {
+      if (g_strcmp0 (enabled_miners[i], name) == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GError *error = NULL;
+  GList *apps = NULL;
+  GList *l;
+  GMainLoop *loop;
+  GOptionContext *context;
+  const gchar *env;
+  guint i;
+
+  context = g_option_context_new ("- host several online miners in one process");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  /* instead of running everything in the idle classes */
+  gom_governor_init ();
+
+  gom_trace_init (g_getenv ("GOM_TRACE_FILE"));
+  gom_recorder_init (g_getenv ("GOM_RECORD_FILE"));
+  gom_recorder_init_replay (g_getenv ("GOM_REPLAY_FILE"));
+
+  /* in KiB, shared by all the hosted miners */
+  env = g_getenv ("GOM_MINER_HOST_CACHE_BUDGET");
+  if (env != NULL)
+    gom_tracker_cache_set_budget ((gsize) g_ascii_strtoull (env, NULL, 10) * 1024);
+
+  /* in milliseconds */
+  env = g_getenv ("GOM_MINER_HOST_SLOW_QUERY");
+  if (env != NULL)
+    gom_tracker_stats_set_slow_threshold ((gint64) g_ascii_strtoull (env, NULL, 10) * 1000);
+
+  for (i = 0; hosted_miners[i].name != NULL; i++)
+    {
+      GApplication *app;
+
+      if (!miner_is_enabled (hosted_miners[i].name))
+        continue;
+
+      app = gom_application_new (hosted_miners[i].bus_name, hosted_miners[i].get_type ());
+
+      if (!g_application_register (app, NULL, &error))
+        {
+          g_warning ("Unable to register %s: %s", hosted_miners[i].bus_name, error->message);
+          g_clear_error (&error);
+          g_object_unref (app);
+          continue;
+        }
+
+      /* a standalone miner already owns the name */
+      if (g_application_get_is_remote (app))
+        {
+          g_warning ("%s is already running, not hosting it", hosted_miners[i].bus_name);
+          g_object_unref (app);
+          continue;
+        }
+
+      g_debug ("Hosting %s", hosted_miners[i].bus_name);
+      apps = g_list_prepend (apps, app);
+    }
+
+  if (apps == NULL)
+    {
+      g_printerr ("No miner to host\n");
+      g_strfreev (enabled_miners);
+      return 1;
+    }
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  g_unix_signal_add_full (G_PRIORITY_DEFAULT,
+                          SIGTERM,
+                          signal_handler_cb,
+                          loop, NULL);
+  g_unix_signal_add_full (G_PRIORITY_DEFAULT,
+                          SIGINT,
+                          signal_handler_cb,
+                          loop, NULL);
+  g_unix_signal_add_full (G_PRIORITY_DEFAULT,
+                          SIGUSR1,
+                          dump_stats_cb,
+                          NULL, NULL);
+
+  g_main_loop_run (loop);
+
+  /* the apps are only registered, not run, so do what
+   * g_application_run() would on the way out: the miners cancel what
+   * they are doing
+   */
+  for (l = apps; l != NULL; l = l->next)
+    g_signal_emit_by_name (l->data, "shutdown");
+
+  g_list_free_full (apps, g_object_unref);
+  g_main_loop_unref (loop);
+  g_strfreev (enabled_miners);
+
+  return 0;
+}
@@ -25,14 +25,14 @@
 #error "gom-miner-main.c is meant to be included, not compiled standalone"
 #endif
 
-#include <unistd.h>
-
 #include <glib-unix.h>
 #include <glib.h>
 
 #include "gom-application.h"
-#include "tracker-ioprio.h"
-#include "tracker-sched.h"
+#include "gom-governor.h"
+#include "gom-recorder.h"
+#include "gom-trace.h"
+#include "gom-tracker.h"
 
 static gboolean
 signal_handler_cb (gpointer user_data)
@@ -43,29 +43,50 @@ signal_handler_cb (gpointer user_data)
   return FALSE;
 }
 
+static gboolean
+dump_stats_cb (gpointer user_data)
+{
+  gom_tracker_stats_dump ();
+  return TRUE;
+}
+
 int
 main (int argc,
       char **argv)
 {
   GApplication *app;
+  const gchar *env;
   gint exit_status;
 
-  tracker_sched_idle ();
-  tracker_ioprio_init ();
+  /* instead of running everything in the idle classes */
+  gom_governor_init ();
 
-  errno = 0;
-  if (nice (19) == -1 && errno != 0)
-    {
-      const gchar *str;
-
-      str = g_strerror (errno);
-      g_warning ("Couldn't set nice value to 19, %s", (str != NULL) ? str : "no error given");
-    }
+  gom_trace_init (g_getenv ("GOM_TRACE_FILE"));
+  gom_recorder_init (g_getenv ("GOM_RECORD_FILE"));
+  gom_recorder_init_replay (g_getenv ("GOM_REPLAY_FILE"));
 
   app = gom_application_new (MINER_BUS_NAME, MINER_TYPE);
   if (g_getenv (MINER_NAME "_MINER_PERSIST") != NULL)
     g_application_hold (app);
 
+  /* keep the services and the resolved URNs around for this many
+   * seconds after the last request, instead of exiting right away.
+   */
+  env = g_getenv (MINER_NAME "_MINER_IDLE_TIMEOUT");
+  if (env != NULL)
+    g_application_set_inactivity_timeout (app, (guint) MIN (g_ascii_strtoull (env, NULL, 10) * 1000,
+                                                            G_MAXUINT));
+
+  /* in KiB */
+  env = g_getenv (MINER_NAME "_MINER_CACHE_BUDGET");
+  if (env != NULL)
+    gom_tracker_cache_set_budget ((gsize) g_ascii_strtoull (env, NULL, 10) * 1024);
+
+  /* in milliseconds */
+  env = g_getenv (MINER_NAME "_MINER_SLOW_QUERY");
+  if (env != NULL)
+    gom_tracker_stats_set_slow_threshold ((gint64) g_ascii_strtoull (env, NULL, 10) * 1000);
+
   g_unix_signal_add_full (G_PRIORITY_DEFAULT,
 			  SIGTERM,
 			  signal_handler_cb,
@@ -74,6 +95,10 @@ main (int argc,
 			  SIGINT,
 			  signal_handler_cb,
 			  app, NULL);
+  g_unix_signal_add_full (G_PRIORITY_DEFAULT,
+                          SIGUSR1,
+                          dump_stats_cb,
+                          NULL, NULL);
 
   exit_status = g_application_run (app, argc, argv);
   g_object_unref (app);
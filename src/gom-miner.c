@@ -25,8 +25,11 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 
+#include "gom-governor.h"
 #include "gom-miner.h"
+#include "gom-trace.h"
 
 G_DEFINE_TYPE (GomMiner, gom_miner, G_TYPE_OBJECT)
 
@@ -39,14 +42,59 @@ struct _GomMinerPrivate {
 
   gchar *display_name;
   gchar **index_types;
+
+  /* account ID -> services created by create_services. Only used from
+   * the main thread; jobs hold their own reference on the table.
+   */
+  GHashTable *services;
+
+  /* the client and the connection are created asynchronously, calls
+   * made before both are there wait in pending_calls
+   */
+  guint pending_inits;
+  GQueue *pending_calls;
+
+  /* account ID, or "" for the miner as a whole -> current phase, and
+   * the a{sv} metrics of its last refresh. Only used from the main
+   * thread.
+   */
+  GHashTable *phases;
+  GHashTable *metrics;
+};
+
+enum
+{
+  PROP_0,
+  PROP_CONNECTION,
+  PROP_DISPLAY_NAME
+};
+
+enum
+{
+  PHASE_CHANGED,
+  ACCOUNT_REFRESHED,
+  LAST_SIGNAL
 };
 
+static guint signals[LAST_SIGNAL] = { 0 };
+
+typedef void (*GomMinerReadyFunc) (GomMiner *self, GTask *task);
+
+typedef struct {
+  GTask *task;
+  GomMinerReadyFunc func;
+} PendingCall;
+
 typedef struct {
   GomMiner *self;
   GList *content_objects;
-  GList *acc_objects;
-  GList *old_datasources;
+  GHashTable *current_datasources;
+  GHashTable *migrated_datasources;
+  GHashTable *outdated_datasources;
+  GHashTable *removed_datasources;
   GList *pending_jobs;
+  gint64 start_time;
+  gint64 cleanup_usec;
 } CleanupJob;
 
 typedef struct {
@@ -56,11 +104,63 @@ typedef struct {
   gchar *shared_type;
   gchar *source_urn;
   gpointer service;
+  GHashTable *services;
 } InsertSharedContentData;
 
+typedef struct {
+  gchar *account_id;
+  gchar *shared_type;
+  gpointer service;
+  GHashTable *services;
+  GPtrArray *items;
+} SharedContentGroup;
+
+typedef struct {
+  GomMiner *self;
+  GList *groups;
+  GVariant *items;
+
+  /* the first account and type that could not be resolved */
+  GError *error;
+} InsertSharedContentBatchData;
+
+typedef struct {
+  TrackerSparqlConnection *connection;
+  gchar *datasource_urn;
+} PurgeJob;
+
+typedef struct {
+  GomMiner *self;
+  gchar *account_id;
+  const gchar *phase;
+} PhaseChange;
+
 static GThreadPool *cleanup_pool;
 
+/* Account jobs run there, in SCHED_IDLE and at nice 19 */
+static GThreadPool *crawl_pool;
+
+static const gint MAX_CRAWL_THREADS = 4;
+
+/* Removed accounts are purged by a single background thread, while the
+ * remaining ones are being refreshed. It is not shared with other pools,
+ * as it runs in SCHED_IDLE. purge_datasources holds the URNs that are
+ * queued or being purged.
+ */
+static GThreadPool *purge_pool;
+static GHashTable *purge_datasources;
+static GMutex purge_mutex;
+
+static const guint PURGE_BATCH_SIZE = GOM_TRACKER_DELETER_DEFAULT_BATCH_SIZE;
+
+/* Miners hosted by the same process share a single client; it goes away
+ * with the last of them.
+ */
+static GoaClient *shared_client;
+
 static void cleanup_job (gpointer data, gpointer user_data);
+static void crawl_job (gpointer data, gpointer user_data);
+static void purge_job (gpointer data, gpointer user_data);
 
 static void
 gom_account_miner_job_free (GomAccountMinerJob *job)
@@ -83,7 +183,11 @@ gom_account_miner_job_free (GomAccountMinerJob *job)
 static void
 gom_insert_shared_content_data_free (InsertSharedContentData *data)
 {
-  GOM_MINER_GET_CLASS (data->self)->destroy_service (data->self, data->service);
+  /* a service borrowed from the cache belongs to its table */
+  if (data->services != NULL)
+    g_hash_table_unref (data->services);
+  else if (data->service != NULL)
+    GOM_MINER_GET_CLASS (data->self)->destroy_service (data->self, data->service);
 
   g_object_unref (data->self);
   g_free (data->account_id);
@@ -99,8 +203,7 @@ gom_insert_shared_content_data_new (GomMiner *self,
                                     const gchar *account_id,
                                     const gchar *shared_id,
                                     const gchar *shared_type,
-                                    const gchar *source_urn,
-                                    gpointer service)
+                                    const gchar *source_urn)
 {
   InsertSharedContentData *retval;
 
@@ -110,18 +213,85 @@ gom_insert_shared_content_data_new (GomMiner *self,
   retval->shared_id = g_strdup (shared_id);
   retval->shared_type = g_strdup (shared_type);
   retval->source_urn = g_strdup (source_urn);
-  retval->service = service;
 
   return retval;
 }
 
+static void
+gom_shared_content_item_free (GomSharedContentItem *item)
+{
+  g_free (item->shared_id);
+  g_free (item->source_urn);
+  g_slice_free (GomSharedContentItem, item);
+}
+
+static SharedContentGroup *
+gom_shared_content_group_new (const gchar *account_id,
+                              const gchar *shared_type,
+                              gpointer service,
+                              GHashTable *services)
+{
+  SharedContentGroup *group;
+
+  group = g_slice_new0 (SharedContentGroup);
+  group->account_id = g_strdup (account_id);
+  group->shared_type = g_strdup (shared_type);
+  group->service = service;
+  group->services = (services != NULL) ? g_hash_table_ref (services) : NULL;
+  group->items = g_ptr_array_new_with_free_func ((GDestroyNotify) gom_shared_content_item_free);
+
+  return group;
+}
+
+static void
+gom_insert_shared_content_batch_data_free (InsertSharedContentBatchData *data)
+{
+  GList *l;
+
+  for (l = data->groups; l != NULL; l = l->next)
+    {
+      SharedContentGroup *group = l->data;
+
+      if (group->services != NULL)
+        g_hash_table_unref (group->services);
+      else
+        GOM_MINER_GET_CLASS (data->self)->destroy_service (data->self, group->service);
+
+      g_free (group->account_id);
+      g_free (group->shared_type);
+      g_ptr_array_unref (group->items);
+      g_slice_free (SharedContentGroup, group);
+    }
+
+  g_list_free (data->groups);
+  g_variant_unref (data->items);
+  g_clear_error (&data->error);
+  g_object_unref (data->self);
+  g_slice_free (InsertSharedContentBatchData, data);
+}
+
 static void
 gom_miner_dispose (GObject *object)
 {
   GomMiner *self = GOM_MINER (object);
 
+  if (self->priv->client != NULL)
+    g_signal_handlers_disconnect_by_data (self->priv->client, self);
+
   g_clear_object (&self->priv->client);
   g_clear_object (&self->priv->connection);
+  g_clear_pointer (&self->priv->services, g_hash_table_unref);
+
+  /* every pending call holds a reference on the miner */
+  if (self->priv->pending_calls != NULL)
+    {
+      g_assert (g_queue_is_empty (self->priv->pending_calls));
+      g_queue_free (self->priv->pending_calls);
+      self->priv->pending_calls = NULL;
+    }
+
+  g_clear_pointer (&self->priv->phases, g_hash_table_unref);
+  g_clear_pointer (&self->priv->metrics, g_hash_table_unref);
 
   g_free (self->priv->display_name);
   g_strfreev (self->priv->index_types);
@@ -131,6 +301,89 @@ gom_miner_dispose (GObject *object)
   G_OBJECT_CLASS (gom_miner_parent_class)->dispose (object);
 }
 
+static void
+gom_miner_account_changed_cb (GoaClient *client,
+                              GoaObject *object,
+                              gpointer user_data)
+{
+  GomMiner *self = GOM_MINER (user_data);
+  GoaAccount *account;
+
+  account = goa_object_peek_account (object);
+  if (account == NULL)
+    return;
+
+  /* the credentials or the enabled services might have changed */
+  g_hash_table_remove (self->priv->services, goa_account_get_id (account));
+}
+
+/* Returns the services of the account, creating them the first time,
+ * so that consecutive refreshes reuse the same authorizers and HTTP
+ * sessions.
+ */
+static GHashTable *
+gom_miner_dup_services (GomMiner *self,
+                        GoaObject *object)
+{
+  GoaAccount *account;
+  GHashTable *services;
+  const gchar *account_id;
+
+  account = goa_object_peek_account (object);
+  account_id = goa_account_get_id (account);
+
+  services = g_hash_table_lookup (self->priv->services, account_id);
+  if (services == NULL)
+    {
+      services = GOM_MINER_GET_CLASS (self)->create_services (self, object);
+      g_hash_table_insert (self->priv->services, g_strdup (account_id), services);
+    }
+
+  return g_hash_table_ref (services);
+}
+
+/* Prefers the cached service of the account, in which case @services is
+ * set to the table it must be borrowed from.
+ */
+static gpointer
+gom_miner_create_service (GomMiner *self,
+                          GoaObject *object,
+                          const gchar *type,
+                          GHashTable **services)
+{
+  *services = NULL;
+
+  if (self->priv->index_types != NULL)
+    {
+      GHashTable *cached;
+      gpointer service;
+
+      cached = gom_miner_dup_services (self, object);
+      service = g_hash_table_lookup (cached, type);
+      if (service != NULL)
+        {
+          *services = cached;
+          return service;
+        }
+
+      g_hash_table_unref (cached);
+    }
+
+  return GOM_MINER_GET_CLASS (self)->create_service (self, object, type);
+}
+
+static void
+gom_miner_set_display_name (GomMiner *self,
+                            const gchar *display_name)
+{
+  if (g_strcmp0 (self->priv->display_name, display_name) == 0)
+    return;
+
+  g_free (self->priv->display_name);
+  self->priv->display_name = g_strdup (display_name);
+  g_object_notify (G_OBJECT (self), "display-name");
+}
+
 static void
 gom_miner_init_goa (GomMiner *self)
 {
@@ -140,8 +393,6 @@ gom_miner_init_goa (GomMiner *self)
   GList *accounts, *l;
   GomMinerClass *miner_class = GOM_MINER_GET_CLASS (self);
 
-  self->priv->client = goa_client_new_sync (NULL, &self->priv->client_error);
-
   if (self->priv->client_error != NULL)
     {
       g_critical ("Unable to create GoaClient: %s - indexing for %s will not work",
@@ -149,6 +400,11 @@ gom_miner_init_goa (GomMiner *self)
       return;
     }
 
+  g_signal_connect (self->priv->client, "account-changed",
+                    G_CALLBACK (gom_miner_account_changed_cb), self);
+  g_signal_connect (self->priv->client, "account-removed",
+                    G_CALLBACK (gom_miner_account_changed_cb), self);
+
   accounts = goa_client_get_accounts (self->priv->client);
   for (l = accounts; l != NULL; l = l->next)
     {
@@ -161,8 +417,11 @@ gom_miner_init_goa (GomMiner *self)
       provider_type = goa_account_get_provider_type (account);
       if (g_strcmp0 (provider_type, miner_class->goa_provider_type) == 0)
         {
-          g_free (self->priv->display_name);
-          self->priv->display_name = goa_account_dup_provider_name (account);
+          gchar *display_name;
+
+          display_name = goa_account_dup_provider_name (account);
+          gom_miner_set_display_name (self, display_name);
+          g_free (display_name);
           break;
         }
     }
@@ -171,32 +430,205 @@ gom_miner_init_goa (GomMiner *self)
 }
 
 static void
-gom_miner_constructed (GObject *obj)
+gom_miner_init_done (GomMiner *self)
 {
-  GomMiner *self = GOM_MINER (obj);
+  PendingCall *call;
 
-  G_OBJECT_CLASS (gom_miner_parent_class)->constructed (obj);
+  g_assert (self->priv->pending_inits > 0);
 
-  gom_miner_init_goa (self);
+  self->priv->pending_inits--;
+  if (self->priv->pending_inits > 0)
+    return;
+
+  while ((call = g_queue_pop_head (self->priv->pending_calls)) != NULL)
+    {
+      if (!g_task_return_error_if_cancelled (call->task))
+        call->func (self, call->task);
+
+      g_object_unref (call->task);
+      g_slice_free (PendingCall, call);
+    }
 }
 
+/* Runs @func right away if the client and the connection are ready,
+ * otherwise once they are.
+ */
 static void
-gom_miner_init (GomMiner *self)
+gom_miner_when_ready (GomMiner *self,
+                      GTask *task,
+                      GomMinerReadyFunc func)
 {
-  GomMinerClass *klass = GOM_MINER_GET_CLASS (self);
+  PendingCall *call;
 
-  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, GOM_TYPE_MINER, GomMinerPrivate);
-  self->priv->display_name = g_strdup ("");
+  if (self->priv->pending_inits == 0)
+    {
+      func (self, task);
+      return;
+    }
+
+  call = g_slice_new0 (PendingCall);
+  call->task = g_object_ref (task);
+  call->func = func;
+  g_queue_push_tail (self->priv->pending_calls, call);
+}
+
+/* Returns FALSE, after returning the error on @task, if either the
+ * client or the connection could not be created.
+ */
+static gboolean
+gom_miner_check_initialized (GomMiner *self,
+                             GTask *task)
+{
+  if (self->priv->client_error != NULL)
+    {
+      g_task_return_error (task, g_error_copy (self->priv->client_error));
+      return FALSE;
+    }
 
-  self->priv->connection = tracker_sparql_connection_get (NULL, &self->priv->connection_error);
+  if (self->priv->connection_error != NULL)
+    {
+      g_task_return_error (task, g_error_copy (self->priv->connection_error));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+gom_miner_goa_client_new_cb (GObject *source,
+                             GAsyncResult *res,
+                             gpointer user_data)
+{
+  GomMiner *self = GOM_MINER (user_data);
+  GoaClient *client;
+
+  client = goa_client_new_finish (res, &self->priv->client_error);
+  if (client != NULL)
+    {
+      /* another hosted miner might have got there first */
+      if (shared_client == NULL)
+        {
+          shared_client = client;
+          g_object_add_weak_pointer (G_OBJECT (shared_client), (gpointer *) &shared_client);
+        }
+      else
+        {
+          g_object_unref (client);
+          client = g_object_ref (shared_client);
+        }
+    }
+
+  self->priv->client = client;
+  gom_miner_init_goa (self);
+  gom_miner_init_done (self);
+
+  g_object_unref (self);
+}
+
+static void
+gom_miner_connection_get_cb (GObject *source,
+                             GAsyncResult *res,
+                             gpointer user_data)
+{
+  GomMiner *self = GOM_MINER (user_data);
+
+  self->priv->connection = tracker_sparql_connection_get_finish (res, &self->priv->connection_error);
   if (self->priv->connection_error != NULL)
     {
       g_critical ("Unable to create TrackerSparqlConnection: %s - indexing for %s will not work",
                   self->priv->connection_error->message,
-                  klass->goa_provider_type);
+                  GOM_MINER_GET_CLASS (self)->goa_provider_type);
+    }
+
+  gom_miner_init_done (self);
+
+  g_object_unref (self);
+}
+
+static void
+gom_miner_constructed (GObject *obj)
+{
+  GomMiner *self = GOM_MINER (obj);
+
+  G_OBJECT_CLASS (gom_miner_parent_class)->constructed (obj);
+
+  /* don't hold up the D-Bus activation, nothing needs them before the
+   * first request comes in
+   */
+  self->priv->pending_inits = (self->priv->connection == NULL) ? 2 : 1;
+
+  if (shared_client != NULL)
+    {
+      self->priv->client = g_object_ref (shared_client);
+      gom_miner_init_goa (self);
+      gom_miner_init_done (self);
+    }
+  else
+    {
+      goa_client_new (NULL, gom_miner_goa_client_new_cb, g_object_ref (self));
+    }
+
+  if (self->priv->connection == NULL)
+    tracker_sparql_connection_get_async (NULL, gom_miner_connection_get_cb, g_object_ref (self));
+}
+
+static void
+gom_miner_get_property (GObject *object,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+  GomMiner *self = GOM_MINER (object);
+
+  switch (prop_id)
+    {
+    case PROP_CONNECTION:
+      g_value_set_object (value, self->priv->connection);
+      break;
+
+    case PROP_DISPLAY_NAME:
+      g_value_set_string (value, self->priv->display_name);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gom_miner_set_property (GObject *object,
+                        guint prop_id,
+                        const GValue *value,
+                        GParamSpec *pspec)
+{
+  GomMiner *self = GOM_MINER (object);
+
+  switch (prop_id)
+    {
+    case PROP_CONNECTION:
+      self->priv->connection = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
     }
 }
 
+static void
+gom_miner_init (GomMiner *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, GOM_TYPE_MINER, GomMinerPrivate);
+  self->priv->display_name = g_strdup ("");
+  self->priv->services = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, (GDestroyNotify) g_hash_table_unref);
+  self->priv->pending_calls = g_queue_new ();
+  self->priv->phases = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->priv->metrics = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, (GDestroyNotify) g_variant_unref);
+}
+
 static void
 gom_miner_class_init (GomMinerClass *klass)
 {
@@ -204,22 +636,130 @@ gom_miner_class_init (GomMinerClass *klass)
 
   oclass->constructed = gom_miner_constructed;
   oclass->dispose = gom_miner_dispose;
+  oclass->get_property = gom_miner_get_property;
+  oclass->set_property = gom_miner_set_property;
 
-  cleanup_pool = g_thread_pool_new (cleanup_job, NULL, 1, FALSE, NULL);
+  /* by default, the miner uses the connection to the tracker store of
+   * the session
+   */
+  g_object_class_install_property (oclass,
+                                   PROP_CONNECTION,
+                                   g_param_spec_object ("connection",
+                                                        "Connection",
+                                                        "The connection to the tracker store",
+                                                        TRACKER_SPARQL_TYPE_CONNECTION,
+                                                        G_PARAM_READWRITE
+                                                        | G_PARAM_CONSTRUCT_ONLY
+                                                        | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (oclass,
+                                   PROP_DISPLAY_NAME,
+                                   g_param_spec_string ("display-name",
+                                                        "Display name",
+                                                        "The name of the provider, once it is known",
+                                                        "",
+                                                        G_PARAM_READABLE
+                                                        | G_PARAM_STATIC_STRINGS));
+
+  /* the account ID is "" for the phases of the miner as a whole, and
+   * the phase is "idle" once it is over
+   */
+  signals[PHASE_CHANGED] = g_signal_new ("phase-changed",
+                                         G_TYPE_FROM_CLASS (klass),
+                                         G_SIGNAL_RUN_LAST,
+                                         0, NULL, NULL, NULL,
+                                         G_TYPE_NONE, 2,
+                                         G_TYPE_STRING, G_TYPE_STRING);
+
+  signals[ACCOUNT_REFRESHED] = g_signal_new ("account-refreshed",
+                                             G_TYPE_FROM_CLASS (klass),
+                                             G_SIGNAL_RUN_LAST,
+                                             0, NULL, NULL, NULL,
+                                             G_TYPE_NONE, 2,
+                                             G_TYPE_STRING, G_TYPE_VARIANT);
+
+  /* crawls and cleanups are background work, whoever asked for the
+   * refresh: their threads are exclusive, so that they can be demoted
+   * for good without slowing down InsertSharedContent
+   */
+  crawl_pool = g_thread_pool_new (crawl_job, NULL, MAX_CRAWL_THREADS, TRUE, NULL);
+  cleanup_pool = g_thread_pool_new (cleanup_job, NULL, 1, TRUE, NULL);
+  purge_pool = g_thread_pool_new (purge_job, NULL, 1, TRUE, NULL);
 
   g_type_class_add_private (klass, sizeof (GomMinerPrivate));
 }
 
+/* A NULL phase means idle. Main thread only. */
+static void
+gom_miner_set_phase (GomMiner *self,
+                     const gchar *account_id,
+                     const gchar *phase)
+{
+  if (phase != NULL)
+    g_hash_table_insert (self->priv->phases, g_strdup (account_id), (gpointer) phase);
+  else
+    g_hash_table_remove (self->priv->phases, account_id);
+
+  g_signal_emit (self, signals[PHASE_CHANGED], 0, account_id, (phase != NULL) ? phase : "idle");
+}
+
+static void
+gom_miner_set_metrics (GomMiner *self,
+                       const gchar *account_id,
+                       GVariant *metrics)
+{
+  g_hash_table_insert (self->priv->metrics, g_strdup (account_id), g_variant_ref_sink (metrics));
+}
+
+static gboolean
+phase_change_cb (gpointer data)
+{
+  PhaseChange *change = data;
+
+  gom_miner_set_phase (change->self, change->account_id, change->phase);
+
+  g_object_unref (change->self);
+  g_free (change->account_id);
+  g_slice_free (PhaseChange, change);
+
+  return FALSE;
+}
+
+static void
+gom_account_miner_job_set_phase (GomAccountMinerJob *job,
+                                 const gchar *phase)
+{
+  PhaseChange *change;
+
+  change = g_slice_new0 (PhaseChange);
+  change->self = g_object_ref (job->miner);
+  change->account_id = g_strdup (goa_account_get_id (job->account));
+  change->phase = phase;
+
+  g_main_context_invoke (NULL, phase_change_cb, change);
+}
+
 static void
 gom_miner_check_pending_jobs (GTask *task)
 {
   CleanupJob *cleanup_job;
+  GomMiner *self;
+  GVariantBuilder builder;
 
   cleanup_job = (CleanupJob *) g_task_get_task_data (task);
 
   if (g_list_length (cleanup_job->pending_jobs) > 0)
     return;
 
+  self = GOM_MINER (g_task_get_source_object (task));
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "cleanup-usec",
+                         g_variant_new_uint64 (cleanup_job->cleanup_usec));
+  g_variant_builder_add (&builder, "{sv}", "refresh-usec",
+                         g_variant_new_uint64 (g_get_monotonic_time () - cleanup_job->start_time));
+  gom_miner_set_metrics (self, "", g_variant_builder_end (&builder));
+
   g_task_return_boolean (task, TRUE);
   g_slice_free (CleanupJob, cleanup_job);
 }
@@ -244,11 +784,12 @@ gom_miner_ensure_datasource (GomMiner *self,
                           datasource_urn, klass->miner_identifier,
                           root_element_urn, datasource_urn, klass->version);
 
-  tracker_sparql_connection_update (self->priv->connection,
-                                    datasource_insert->str,
-                                    G_PRIORITY_DEFAULT,
-                                    cancellable,
-                                    error);
+  gom_tracker_sparql_connection_update (self->priv->connection,
+                                        G_STRFUNC,
+                                        datasource_insert->str,
+                                        G_PRIORITY_DEFAULT,
+                                        cancellable,
+                                        error);
 
   g_string_free (datasource_insert, TRUE);
 }
@@ -268,10 +809,11 @@ gom_account_miner_job_query_existing (GomAccountMinerJob *job,
                           "SELECT ?urn nao:identifier(?urn) WHERE { ?urn nie:dataSource <%s> }",
                           job->datasource_urn);
 
-  cursor = tracker_sparql_connection_query (job->connection,
-                                            select->str,
-                                            cancellable,
-                                            error);
+  cursor = gom_tracker_sparql_connection_query (job->connection,
+                                                G_STRFUNC,
+                                                select->str,
+                                                cancellable,
+                                                error);
   g_string_free (select, TRUE);
 
   if (cursor == NULL)
@@ -287,45 +829,39 @@ gom_account_miner_job_query_existing (GomAccountMinerJob *job,
   g_object_unref (cursor);
 }
 
-static void
-previous_resources_cleanup_foreach (gpointer key,
-                                    gpointer value,
-                                    gpointer user_data)
-{
-  const gchar *resource = value;
-  GString *delete = user_data;
-
-  g_string_append_printf (delete, "<%s> a rdfs:Resource . ", resource);
-}
-
 static void
 gom_account_miner_job_cleanup_previous (GomAccountMinerJob *job,
                                         GError **error)
 {
   GCancellable *cancellable;
-  GString *delete;
+  GHashTableIter iter;
+  GomTrackerDeleter *deleter;
+  const gchar *resource;
 
-  cancellable = g_task_get_cancellable (job->task);
+  if (g_hash_table_size (job->previous_resources) == 0)
+    return;
 
-  delete = g_string_new (NULL);
-  g_string_append (delete, "DELETE { ");
+  cancellable = g_task_get_cancellable (job->task);
+  deleter = gom_tracker_deleter_new (job->connection,
+                                     GOM_TRACKER_DELETER_DEFAULT_BATCH_SIZE,
+                                     G_PRIORITY_DEFAULT,
+                                     cancellable);
 
   /* the resources left here are those who were in the database,
    * but were not found during the query; remove them from the database.
    */
-  g_hash_table_foreach (job->previous_resources,
-                        previous_resources_cleanup_foreach,
-                        delete);
-
-  g_string_append (delete, "}");
+  g_hash_table_iter_init (&iter, job->previous_resources);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &resource))
+    {
+      if (!gom_tracker_deleter_add (deleter, resource, error))
+        goto out;
+    }
 
-  tracker_sparql_connection_update (job->connection,
-                                    delete->str,
-                                    G_PRIORITY_DEFAULT,
-                                    cancellable,
-                                    error);
+  gom_tracker_deleter_flush (deleter, error);
 
-  g_string_free (delete, TRUE);
+ out:
+  g_debug ("Removed %u vanished resources", gom_tracker_deleter_get_n_deleted (deleter));
+  gom_tracker_deleter_free (deleter);
 }
 
 static void
@@ -333,10 +869,35 @@ gom_account_miner_job_query (GomAccountMinerJob *job,
                              GError **error)
 {
   GomMinerClass *miner_class = GOM_MINER_GET_CLASS (job->miner);
+  GomTrackerBatch *batch = NULL;
   GCancellable *cancellable;
+  gint64 trace;
 
   cancellable = g_task_get_cancellable (job->task);
+
+  /* a new account, or one that was just purged: nothing can be found in
+   * the store, so skip the lookups and insert in bulk
+   */
+  if (g_hash_table_size (job->previous_resources) == 0)
+    {
+      g_debug ("No previous resources in %s, importing in bulk", job->datasource_urn);
+      batch = gom_tracker_batch_new (job->connection, cancellable);
+      gom_tracker_batch_push_thread_default (batch);
+    }
+
+  trace = gom_trace_begin ();
   miner_class->query (job, job->connection, job->previous_resources, job->datasource_urn, cancellable, error);
+  gom_trace_end (trace, "provider", miner_class->miner_identifier);
+
+  if (batch != NULL)
+    {
+      gom_tracker_batch_pop_thread_default (batch);
+
+      if (*error == NULL)
+        gom_tracker_batch_flush (batch, error);
+
+      gom_tracker_batch_free (batch);
+    }
 }
 
 static void
@@ -347,34 +908,77 @@ gom_account_miner_job (GTask *task,
 {
   GomAccountMinerJob *job = task_data;
   GError *error = NULL;
+  gint64 job_trace;
+  gint64 start;
+  gint64 trace;
+
+  gom_tracker_counters_push_thread_default (&job->counters);
+  gom_trace_set_thread_account (goa_account_get_id (job->account));
+  job_trace = gom_trace_begin ();
 
+  trace = gom_trace_begin ();
   gom_miner_ensure_datasource (job->miner, job->datasource_urn, job->root_element_urn, cancellable, &error);
+  gom_trace_end (trace, "miner", "ensure-datasource");
 
   if (error != NULL)
     goto out;
 
+  gom_account_miner_job_set_phase (job, "query-existing");
+  trace = gom_trace_begin ();
+  start = g_get_monotonic_time ();
   gom_account_miner_job_query_existing (job, &error);
+  job->query_existing_usec = g_get_monotonic_time () - start;
+  gom_trace_end (trace, "miner", "query-existing");
 
   if (error != NULL)
     goto out;
 
+  gom_account_miner_job_set_phase (job, "query");
+  trace = gom_trace_begin ();
+  start = g_get_monotonic_time ();
   gom_account_miner_job_query (job, &error);
+  job->query_usec = g_get_monotonic_time () - start;
+  gom_trace_end (trace, "miner", "query");
 
   if (error != NULL)
     goto out;
 
+  gom_account_miner_job_set_phase (job, "cleanup-previous");
+  trace = gom_trace_begin ();
+  start = g_get_monotonic_time ();
   gom_account_miner_job_cleanup_previous (job, &error);
+  job->cleanup_previous_usec = g_get_monotonic_time () - start;
+  gom_trace_end (trace, "miner", "cleanup-previous");
 
   if (error != NULL)
     goto out;
 
  out:
+  gom_trace_end (job_trace, "miner", "job");
+  gom_trace_set_thread_account (NULL);
+  gom_tracker_counters_pop_thread_default (&job->counters);
+
   if (error != NULL)
     g_task_return_error (job->task, error);
   else
     g_task_return_boolean (job->task, TRUE);
 }
 
+static void
+crawl_job (gpointer data,
+           gpointer user_data)
+{
+  GTask *task = G_TASK (data);
+
+  gom_governor_demote_thread ();
+
+  gom_account_miner_job (task,
+                         g_task_get_source_object (task),
+                         g_task_get_task_data (task),
+                         g_task_get_cancellable (task));
+  g_object_unref (task);
+}
+
 static void
 gom_account_miner_job_process_async (GomAccountMinerJob *job,
                                      GAsyncReadyCallback callback,
@@ -389,7 +993,7 @@ gom_account_miner_job_process_async (GomAccountMinerJob *job,
   job->task = g_task_new (NULL, cancellable, callback, user_data);
   g_task_set_source_tag (job->task, gom_account_miner_job_process_async);
   g_task_set_task_data (job->task, job, NULL);
-  g_task_run_in_thread (job->task, gom_account_miner_job);
+  g_thread_pool_push (crawl_pool, g_object_ref (job->task), NULL);
 }
 
 static gboolean
@@ -413,7 +1017,6 @@ gom_account_miner_job_new (GomMiner *self,
 {
   GomAccountMinerJob *retval;
   GoaAccount *account;
-  GomMinerClass *miner_class = GOM_MINER_GET_CLASS (self);
 
   account = goa_object_get_account (object);
   g_assert (account != NULL);
@@ -427,7 +1030,7 @@ gom_account_miner_job_new (GomMiner *self,
     g_hash_table_new_full (g_str_hash, g_str_equal,
                            (GDestroyNotify) g_free, (GDestroyNotify) g_free);
 
-  retval->services = miner_class->create_services (self, object);
+  retval->services = gom_miner_dup_services (self, object);
   retval->datasource_urn = g_strdup_printf ("gd:goa-account:%s",
                                             goa_account_get_id (retval->account));
   retval->root_element_urn = g_strdup_printf ("gd:goa-account:%s:root-element",
@@ -436,6 +1039,34 @@ gom_account_miner_job_new (GomMiner *self,
   return retval;
 }
 
+static GVariant *
+gom_account_miner_job_dup_metrics (GomAccountMinerJob *job)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "items-seen",
+                         g_variant_new_uint32 (job->counters.n_seen));
+  g_variant_builder_add (&builder, "{sv}", "items-changed",
+                         g_variant_new_uint32 (job->counters.n_changed));
+  g_variant_builder_add (&builder, "{sv}", "items-deleted",
+                         g_variant_new_uint32 (job->counters.n_deleted));
+  g_variant_builder_add (&builder, "{sv}", "sparql-queries",
+                         g_variant_new_uint32 (job->counters.n_queries));
+  g_variant_builder_add (&builder, "{sv}", "sparql-updates",
+                         g_variant_new_uint32 (job->counters.n_updates));
+  g_variant_builder_add (&builder, "{sv}", "bytes-fetched",
+                         g_variant_new_uint64 (job->bytes_fetched));
+  g_variant_builder_add (&builder, "{sv}", "query-existing-usec",
+                         g_variant_new_uint64 (job->query_existing_usec));
+  g_variant_builder_add (&builder, "{sv}", "query-usec",
+                         g_variant_new_uint64 (job->query_usec));
+  g_variant_builder_add (&builder, "{sv}", "cleanup-previous-usec",
+                         g_variant_new_uint64 (job->cleanup_previous_usec));
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
 static void
 miner_job_process_ready_cb (GObject *source,
                             GAsyncResult *res,
@@ -445,15 +1076,24 @@ miner_job_process_ready_cb (GObject *source,
   GomAccountMinerJob *account_miner_job = user_data;
   GomMiner *self = account_miner_job->miner;
   GError *error = NULL;
+  GVariant *metrics;
+  const gchar *account_id;
 
   cleanup_job = (CleanupJob *) g_task_get_task_data (account_miner_job->parent_task);
+  account_id = goa_account_get_id (account_miner_job->account);
 
   gom_account_miner_job_process_finish (res, &error);
 
+  metrics = gom_account_miner_job_dup_metrics (account_miner_job);
+  gom_miner_set_metrics (self, account_id, metrics);
+  gom_miner_set_phase (self, account_id, NULL);
+  g_signal_emit (self, signals[ACCOUNT_REFRESHED], 0, account_id, metrics);
+  g_variant_unref (metrics);
+
   if (error != NULL)
     {
       g_printerr ("Error while refreshing account %s: %s",
-                  goa_account_get_id (account_miner_job->account), error->message);
+                  account_id, error->message);
 
       g_error_free (error);
     }
@@ -493,6 +1133,9 @@ cleanup_old_accounts_done (gpointer data)
   job = (CleanupJob *) g_task_get_task_data (task);
   self = job->self;
 
+  job->cleanup_usec = g_get_monotonic_time () - job->start_time;
+  gom_miner_set_phase (self, "", NULL);
+
   /* now setup all the current accounts */
   for (l = job->content_objects; l != NULL; l = l->next)
     {
@@ -508,17 +1151,10 @@ cleanup_old_accounts_done (gpointer data)
       job->content_objects = NULL;
     }
 
-  if (job->acc_objects != NULL)
-    {
-      g_list_free_full (job->acc_objects, g_object_unref);
-      job->acc_objects = NULL;
-    }
-
-  if (job->old_datasources != NULL)
-    {
-      g_list_free_full (job->old_datasources, g_free);
-      job->old_datasources = NULL;
-    }
+  g_clear_pointer (&job->current_datasources, g_hash_table_unref);
+  g_clear_pointer (&job->migrated_datasources, g_hash_table_unref);
+  g_clear_pointer (&job->outdated_datasources, g_hash_table_unref);
+  g_clear_pointer (&job->removed_datasources, g_hash_table_unref);
 
   gom_miner_check_pending_jobs (task);
 
@@ -527,69 +1163,336 @@ cleanup_old_accounts_done (gpointer data)
   return FALSE;
 }
 
+/* Appends @update with every {datasource} replaced by @datasource; the
+ * update is not a format, so it can use '%' freely.
+ */
 static void
-cleanup_job_do_cleanup (CleanupJob *job, GCancellable *cancellable)
+append_migration_update (GString *out,
+                         const gchar *update,
+                         const gchar *datasource)
+{
+  static const gchar placeholder[] = "{datasource}";
+  const gchar *p, *next;
+
+  for (p = update; (next = strstr (p, placeholder)) != NULL; p = next + strlen (placeholder))
+    {
+      g_string_append_len (out, p, next - p);
+      g_string_append (out, datasource);
+    }
+
+  g_string_append (out, p);
+  g_string_append_c (out, ' ');
+}
+
+/* Contacts of older versions are not in the graph of the datasource,
+ * so deleting it leaves them behind.
+ */
+static void
+delete_legacy_contacts (TrackerSparqlConnection *connection,
+                        const gchar *datasource,
+                        gint priority,
+                        GCancellable *cancellable,
+                        GError **error)
 {
-  GomMiner *self = job->self;
-  GList *l;
   GString *update;
+
+  update = g_string_new (NULL);
+  append_migration_update (update, GOM_MINER_MIGRATION_CONTACTS_INTO_GRAPH, datasource);
+  gom_tracker_sparql_connection_update (connection, G_STRFUNC, update->str, priority, cancellable, error);
+  g_string_free (update, TRUE);
+}
+
+static void
+purge_job (gpointer data,
+           gpointer user_data)
+{
+  PurgeJob *job = data;
   GError *error = NULL;
 
-  if (job->old_datasources == NULL)
-    return;
+  gom_governor_demote_thread ();
+
+  g_debug ("Purging removed datasource %s", job->datasource_urn);
+
+  /* the datasource itself goes last, so an interrupted purge is picked
+   * up again by the next refresh
+   */
+  delete_legacy_contacts (job->connection, job->datasource_urn, G_PRIORITY_LOW, NULL, &error);
+  if (error == NULL)
+    gom_tracker_sparql_connection_delete_datasource (job->connection,
+                                                     NULL,
+                                                     &error,
+                                                     job->datasource_urn,
+                                                     PURGE_BATCH_SIZE,
+                                                     G_PRIORITY_LOW);
+
+  if (error != NULL)
+    {
+      g_printerr ("Error while purging %s: %s\n", job->datasource_urn, error->message);
+      g_error_free (error);
+    }
+
+  g_mutex_lock (&purge_mutex);
+  g_hash_table_remove (purge_datasources, job->datasource_urn);
+  g_mutex_unlock (&purge_mutex);
+
+  g_object_unref (job->connection);
+  g_free (job->datasource_urn);
+  g_slice_free (PurgeJob, job);
+}
+
+static void
+cleanup_job_queue_purge (CleanupJob *job)
+{
+  GHashTableIter iter;
+  const gchar *datasource;
+
+  g_mutex_lock (&purge_mutex);
+
+  if (purge_datasources == NULL)
+    purge_datasources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  g_hash_table_iter_init (&iter, job->removed_datasources);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &datasource, NULL))
+    {
+      PurgeJob *purge;
+
+      if (g_hash_table_contains (purge_datasources, datasource))
+        continue;
+
+      g_hash_table_add (purge_datasources, g_strdup (datasource));
+
+      purge = g_slice_new0 (PurgeJob);
+      purge->connection = g_object_ref (job->self->priv->connection);
+      purge->datasource_urn = g_strdup (datasource);
+      g_thread_pool_push (purge_pool, purge, NULL);
+    }
+
+  g_mutex_unlock (&purge_mutex);
+}
+
+static const GomMinerMigration *
+gom_miner_class_find_migration (GomMinerClass *klass,
+                                gint version)
+{
+  const GomMinerMigration *migration;
+
+  if (klass->migrations == NULL)
+    return NULL;
+
+  for (migration = klass->migrations; migration->version != 0; migration++)
+    {
+      if (migration->version == version)
+        return migration;
+    }
+
+  return NULL;
+}
+
+static gboolean
+gom_miner_class_can_migrate (GomMinerClass *klass,
+                             gint old_version)
+{
+  gint version;
+
+  for (version = old_version + 1; version <= klass->version; version++)
+    {
+      if (gom_miner_class_find_migration (klass, version) == NULL)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Runs all the steps from @old_version and records the new version in
+ * a single update, so that a failure leaves the datasource untouched.
+ */
+static gboolean
+cleanup_job_migrate (CleanupJob *job,
+                     const gchar *datasource,
+                     gint old_version,
+                     GCancellable *cancellable,
+                     GError **error)
+{
+  GomMinerClass *klass = GOM_MINER_GET_CLASS (job->self);
+  GError *local_error = NULL;
+  GString *update;
+  gint version;
+
+  update = g_string_new (NULL);
+
+  for (version = old_version + 1; version <= klass->version; version++)
+    {
+      const GomMinerMigration *migration;
+
+      migration = gom_miner_class_find_migration (klass, version);
+
+      if (migration->update != NULL)
+        append_migration_update (update, migration->update, datasource);
+
+      /* the resources are found by their graph, but their modification
+       * times might have been written elsewhere by an older version
+       */
+      if (migration->refetch)
+        {
+          g_string_append_printf (update,
+                                  "DELETE { ?urn nie:contentLastModified ?mtime } WHERE { "
+                                  "  GRAPH <%s> { ?urn a nie:InformationElement } "
+                                  "  ?urn nie:contentLastModified ?mtime "
+                                  "} ",
+                                  datasource);
+        }
+    }
+
+  g_string_append_printf (update,
+                          "DELETE { ?root nie:version ?version } WHERE { "
+                          "  ?root nie:rootElementOf <%s> ; nie:version ?version "
+                          "} "
+                          "INSERT INTO <%s> { ?root nie:version \"%d\" } WHERE { "
+                          "  ?root nie:rootElementOf <%s> "
+                          "}",
+                          datasource, datasource, klass->version, datasource);
+
+  gom_tracker_sparql_connection_update (job->self->priv->connection,
+                                        G_STRFUNC,
+                                        update->str,
+                                        G_PRIORITY_DEFAULT,
+                                        cancellable,
+                                        &local_error);
+  g_string_free (update, TRUE);
+
+  if (local_error != NULL)
+    {
+      g_propagate_error (error, local_error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+cleanup_job_do_cleanup (CleanupJob *job, GCancellable *cancellable)
+{
+  GomMiner *self = job->self;
+  GHashTableIter iter;
+  const gchar *datasource;
+  gpointer old_version;
 
-  update = g_string_new (NULL);
+  cleanup_job_queue_purge (job);
 
-  for (l = job->old_datasources; l != NULL; l = l->next)
+  g_hash_table_iter_init (&iter, job->migrated_datasources);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &datasource, &old_version))
     {
-      const gchar *resource;
+      GError *error = NULL;
 
-      resource = l->data;
-      g_debug ("Cleaning up old datasource %s", resource);
+      g_debug ("Migrating datasource %s from version %d", datasource, GPOINTER_TO_INT (old_version));
+
+      if (!cleanup_job_migrate (job, datasource, GPOINTER_TO_INT (old_version), cancellable, &error))
+        {
+          /* fall back to mining it from scratch */
+          g_printerr ("Error while migrating %s: %s\n", datasource, error->message);
+          g_error_free (error);
+          g_hash_table_add (job->outdated_datasources, g_strdup (datasource));
+        }
 
-      g_string_append_printf (update,
-                              "DELETE {"
-                              "  ?u a rdfs:Resource"
-                              "} WHERE {"
-                              "  ?u nie:dataSource <%s>"
-                              "}",
-                              resource);
+      /* a migration might have rewritten resources */
+      gom_tracker_cache_remove_graph (datasource);
     }
 
-  tracker_sparql_connection_update (self->priv->connection,
-                                    update->str,
-                                    G_PRIORITY_DEFAULT,
-                                    cancellable,
-                                    &error);
-  g_string_free (update, TRUE);
+  if (g_hash_table_size (job->outdated_datasources) == 0)
+    return;
 
-  if (error != NULL)
+  /* the data written by an older version has to be gone before the
+   * account is mined again
+   */
+  g_hash_table_iter_init (&iter, job->outdated_datasources);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &datasource, NULL))
     {
-      g_printerr ("Error while cleaning up old accounts: %s\n", error->message);
-      g_error_free (error);
+      GError *error = NULL;
+
+      g_debug ("Cleaning up old datasource %s", datasource);
+
+      delete_legacy_contacts (self->priv->connection, datasource, G_PRIORITY_DEFAULT, cancellable, &error);
+      if (error != NULL
+          || !gom_tracker_sparql_connection_drop_datasource (self->priv->connection,
+                                                             cancellable,
+                                                             &error,
+                                                             datasource,
+                                                             G_PRIORITY_DEFAULT))
+        {
+          g_printerr ("Error while cleaning up old accounts: %s\n", error->message);
+          g_error_free (error);
+          break;
+        }
     }
 }
 
-static gint
-cleanup_datasource_compare (gconstpointer a,
-                            gconstpointer b)
+/* Walks the datasources stored in the DB and collects the ones that
+ * have to go, either because their account is gone or because they
+ * were created by an older version of the miner.
+ *
+ * Note that the current datasources include accounts that might *not*
+ * support documents, in case the switch has been disabled in System
+ * Settings. In fact, we only remove all the account data in case the
+ * account is really removed from the panel.
+ */
+static void
+cleanup_job_reconcile (CleanupJob *job,
+                       TrackerSparqlCursor *cursor,
+                       GCancellable *cancellable)
 {
-  GoaObject *object = GOA_OBJECT (a);
-  const gchar *datasource = b;
-  gint res;
+  GomMinerClass *klass = GOM_MINER_GET_CLASS (job->self);
+  guint n_stored = 0, n_removed = 0, n_migrated = 0, n_outdated = 0;
 
-  GoaAccount *account;
-  gchar *object_datasource;
+  while (tracker_sparql_cursor_next (cursor, cancellable, NULL))
+    {
+      const gchar *datasource, *old_version_str;
+      gint old_version;
 
-  account = goa_object_peek_account (object);
-  g_assert (account != NULL);
+      datasource = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+      n_stored++;
+
+      /* there is a row per root element */
+      if (g_hash_table_contains (job->removed_datasources, datasource)
+          || g_hash_table_contains (job->migrated_datasources, datasource)
+          || g_hash_table_contains (job->outdated_datasources, datasource))
+        continue;
+
+      if (!g_hash_table_contains (job->current_datasources, datasource))
+        {
+          g_hash_table_add (job->removed_datasources, g_strdup (datasource));
+          n_removed++;
+          continue;
+        }
+
+      old_version_str = tracker_sparql_cursor_get_string (cursor, 1, NULL);
+      if (old_version_str == NULL)
+        old_version = 1;
+      else
+        sscanf (old_version_str, "%d", &old_version);
+
+      g_debug ("Stored version: %d - new version %d", old_version, klass->version);
 
-  object_datasource = g_strdup_printf ("gd:goa-account:%s", goa_account_get_id (account));
-  res = g_strcmp0 (datasource, object_datasource);
+      if (old_version >= klass->version)
+        continue;
 
-  g_free (object_datasource);
+      if (gom_miner_class_can_migrate (klass, old_version))
+        {
+          g_hash_table_insert (job->migrated_datasources, g_strdup (datasource), GINT_TO_POINTER (old_version));
+          n_migrated++;
+        }
+      else
+        {
+          g_hash_table_add (job->outdated_datasources, g_strdup (datasource));
+          n_outdated++;
+        }
+    }
 
-  return res;
+  g_debug ("Reconciled %u stored datasources against %u accounts: %u removed, %u migrated, %u outdated",
+           n_stored,
+           g_hash_table_size (job->current_datasources),
+           n_removed,
+           n_migrated,
+           n_outdated);
 }
 
 static void
@@ -602,13 +1505,14 @@ cleanup_job (gpointer data,
   GTask *task = G_TASK (data);
   GError *error = NULL;
   TrackerSparqlCursor *cursor;
-  const gchar *datasource, *old_version_str;
-  gint old_version;
-  GList *element;
   CleanupJob *job;
   GomMiner *self;
   GomMinerClass *klass;
+  gint64 trace;
 
+  gom_governor_demote_thread ();
+
+  trace = gom_trace_begin ();
   cancellable = g_task_get_cancellable (task);
   job = (CleanupJob *) g_task_get_task_data (task);
   self = job->self;
@@ -622,10 +1526,11 @@ cleanup_job (gpointer data,
                           "OPTIONAL { ?root nie:rootElementOf ?datasource } }",
                           klass->miner_identifier);
 
-  cursor = tracker_sparql_connection_query (self->priv->connection,
-                                            select->str,
-                                            cancellable,
-                                            &error);
+  cursor = gom_tracker_sparql_connection_query (self->priv->connection,
+                                                G_STRFUNC,
+                                                select->str,
+                                                cancellable,
+                                                &error);
   g_string_free (select, TRUE);
 
   if (error != NULL)
@@ -634,46 +1539,15 @@ cleanup_job (gpointer data,
       goto out;
     }
 
-  while (tracker_sparql_cursor_next (cursor, cancellable, NULL))
-    {
-      /* If the source we found is not in the current list, add
-       * it to the cleanup list.
-       * Note that the objects here in the list might *not* support
-       * documents, in case the switch has been disabled in System Settings.
-       * In fact, we only remove all the account data in case the account
-       * is really removed from the panel.
-       *
-       * Also, cleanup sources for which the version has increased.
-       */
-      datasource = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-      element = g_list_find_custom (job->acc_objects, datasource,
-                                    cleanup_datasource_compare);
-
-      if (element == NULL)
-        job->old_datasources = g_list_prepend (job->old_datasources,
-                                               g_strdup (datasource));
-
-      old_version_str = tracker_sparql_cursor_get_string (cursor, 1, NULL);
-      if (old_version_str == NULL)
-        old_version = 1;
-      else
-        sscanf (old_version_str, "%d", &old_version);
-
-      g_debug ("Stored version: %d - new version %d", old_version, klass->version);
-
-      if ((element == NULL) || (old_version < klass->version))
-        {
-          job->old_datasources = g_list_prepend (job->old_datasources,
-                                                 g_strdup (datasource));
-        }
-    }
-
+  cleanup_job_reconcile (job, cursor, cancellable);
   g_object_unref (cursor);
 
   /* cleanup the DB */
   cleanup_job_do_cleanup (job, cancellable);
 
  out:
+  gom_trace_end (trace, "miner", "cleanup");
+
   source = g_idle_source_new ();
   g_source_set_name (source, "[gnome-online-miners] cleanup_old_accounts_done");
   g_task_attach_source (task, source, cleanup_old_accounts_done);
@@ -685,14 +1559,20 @@ cleanup_job (gpointer data,
 static void
 gom_miner_cleanup_old_accounts (GomMiner *self,
                                 GList *content_objects,
-                                GList *acc_objects,
+                                GHashTable *current_datasources,
                                 GTask *task)
 {
   CleanupJob *job = g_slice_new0 (CleanupJob);
 
   job->self = g_object_ref (self);
   job->content_objects = content_objects;
-  job->acc_objects = acc_objects;
+  job->current_datasources = current_datasources;
+  job->migrated_datasources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  job->outdated_datasources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  job->removed_datasources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  job->start_time = g_get_monotonic_time ();
+
+  gom_miner_set_phase (self, "", "cleanup");
 
   g_task_set_task_data (task, job, NULL);
   g_thread_pool_push (cleanup_pool, g_object_ref (task), NULL);
@@ -706,12 +1586,13 @@ gom_miner_refresh_db_real (GomMiner *self, GTask *task)
   GoaAccount *account;
   GoaObject *object;
   const gchar *provider_type;
-  GList *accounts, *content_objects, *acc_objects, *l;
+  GList *accounts, *content_objects, *l;
+  GHashTable *current_datasources;
   GomMinerClass *miner_class = GOM_MINER_GET_CLASS (self);
   gboolean skip_photos, skip_documents;
 
   content_objects = NULL;
-  acc_objects = NULL;
+  current_datasources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
   accounts = goa_client_get_accounts (self->priv->client);
   for (l = accounts; l != NULL; l = l->next)
@@ -726,7 +1607,8 @@ gom_miner_refresh_db_real (GomMiner *self, GTask *task)
       if (g_strcmp0 (provider_type, miner_class->goa_provider_type) != 0)
         continue;
 
-      acc_objects = g_list_append (acc_objects, g_object_ref (object));
+      g_hash_table_add (current_datasources,
+                        g_strdup_printf ("gd:goa-account:%s", goa_account_get_id (account)));
       skip_photos = skip_documents = TRUE;
 
       documents = goa_object_peek_documents (object);
@@ -746,7 +1628,17 @@ gom_miner_refresh_db_real (GomMiner *self, GTask *task)
 
   g_list_free_full (accounts, g_object_unref);
 
-  gom_miner_cleanup_old_accounts (self, content_objects, acc_objects, task);
+  gom_miner_cleanup_old_accounts (self, content_objects, current_datasources, task);
+}
+
+/* Drops everything that is only kept around to speed up the next
+ * refresh, e.g. under memory pressure.
+ */
+void
+gom_miner_drop_caches (GomMiner *self)
+{
+  g_hash_table_remove_all (self->priv->services);
+  gom_tracker_cache_clear ();
 }
 
 const gchar *
@@ -755,6 +1647,52 @@ gom_miner_get_display_name (GomMiner *self)
   return self->priv->display_name;
 }
 
+/* Returns an a{ss} of the accounts being refreshed and their phase. */
+GVariant *
+gom_miner_dup_phases (GomMiner *self)
+{
+  GHashTableIter iter;
+  GVariantBuilder builder;
+  const gchar *account_id;
+  const gchar *phase;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
+
+  g_hash_table_iter_init (&iter, self->priv->phases);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &account_id, (gpointer *) &phase))
+    g_variant_builder_add (&builder, "{ss}", account_id, phase);
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/* Returns an a{sa{sv}} of the metrics of the last refresh of each
+ * account, and of the miner as a whole under "".
+ */
+GVariant *
+gom_miner_dup_metrics (GomMiner *self)
+{
+  GHashTableIter iter;
+  GVariantBuilder builder;
+  const gchar *account_id;
+  GVariant *metrics;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
+
+  g_hash_table_iter_init (&iter, self->priv->metrics);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &account_id, (gpointer *) &metrics))
+    g_variant_builder_add (&builder, "{s@a{sv}}", account_id, metrics);
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/* Only meant to be called from the thread running @job. */
+void
+gom_account_miner_job_add_bytes_fetched (GomAccountMinerJob *job,
+                                         gsize n_bytes)
+{
+  job->bytes_fetched += n_bytes;
+}
+
 static void
 gom_miner_insert_shared_content_in_thread_func (GTask *task,
                                                 gpointer source_object,
@@ -767,6 +1705,8 @@ gom_miner_insert_shared_content_in_thread_func (GTask *task,
   gchar *datasource_urn = NULL;
   gchar *root_element_urn = NULL;
 
+  gom_governor_set_thread_level (GOM_GOVERNOR_LEVEL_INTERACTIVE);
+
   datasource_urn = g_strdup_printf ("gd:goa-account:%s", data->account_id);
   root_element_urn = g_strdup_printf ("gd:goa-account:%s:root-element", data->account_id);
 
@@ -797,43 +1737,26 @@ gom_miner_insert_shared_content_in_thread_func (GTask *task,
   g_task_return_boolean (task, TRUE);
 
  out:
+  gom_governor_set_thread_level (GOM_GOVERNOR_LEVEL_BACKGROUND);
   g_free (datasource_urn);
   g_free (root_element_urn);
 }
 
-void
-gom_miner_insert_shared_content_async (GomMiner *self,
-                                       const gchar *account_id,
-                                       const gchar *shared_id,
-                                       const gchar *shared_type,
-                                       const gchar *source_urn,
-                                       GCancellable *cancellable,
-                                       GAsyncReadyCallback callback,
-                                       gpointer user_data)
+static void
+gom_miner_insert_shared_content_ready (GomMiner *self,
+                                       GTask *task)
 {
-  GTask *task = NULL;
   GoaDocuments *documents;
   GoaObject *object = NULL;
   GoaPhotos *photos;
   InsertSharedContentData *data;
-  gpointer service;
-
-  task = g_task_new (self, cancellable, callback, user_data);
-  g_task_set_source_tag (task, gom_miner_insert_shared_content_async);
 
-  if (self->priv->client_error != NULL)
-    {
-      g_task_return_error (task, g_error_copy (self->priv->client_error));
-      goto out;
-    }
+  if (!gom_miner_check_initialized (self, task))
+    goto out;
 
-  if (self->priv->connection_error != NULL)
-    {
-      g_task_return_error (task, g_error_copy (self->priv->connection_error));
-      goto out;
-    }
+  data = (InsertSharedContentData *) g_task_get_task_data (task);
 
-  object = goa_client_lookup_by_id (self->priv->client, account_id);
+  object = goa_client_lookup_by_id (self->priv->client, data->account_id);
   if (object == NULL)
     {
       /* throw error */
@@ -843,33 +1766,54 @@ gom_miner_insert_shared_content_async (GomMiner *self,
   documents = goa_object_peek_documents (object);
   photos = goa_object_peek_photos (object);
 
-  if (g_strcmp0 (shared_type, "documents") == 0 && documents == NULL)
+  if (g_strcmp0 (data->shared_type, "documents") == 0 && documents == NULL)
     {
       /* throw error */
       goto out;
     }
 
-  if (g_strcmp0 (shared_type, "photos") == 0 && photos == NULL)
+  if (g_strcmp0 (data->shared_type, "photos") == 0 && photos == NULL)
     {
       /* throw error */
       goto out;
     }
 
-  service = GOM_MINER_GET_CLASS (self)->create_service (self, object, shared_type);
-  if (service == NULL)
+  data->service = gom_miner_create_service (self, object, data->shared_type, &data->services);
+  if (data->service == NULL)
     {
       /* throw error */
       goto out;
     }
 
-  data = gom_insert_shared_content_data_new (self, account_id, shared_id, shared_type, source_urn, service);
-  g_task_set_task_data (task, data, (GDestroyNotify) gom_insert_shared_content_data_free);
-
+  /* ahead of the refresh jobs waiting for a thread */
+  g_task_set_priority (task, G_PRIORITY_HIGH);
   g_task_run_in_thread (task, gom_miner_insert_shared_content_in_thread_func);
 
  out:
   g_clear_object (&object);
-  g_clear_object (&task);
+}
+
+void
+gom_miner_insert_shared_content_async (GomMiner *self,
+                                       const gchar *account_id,
+                                       const gchar *shared_id,
+                                       const gchar *shared_type,
+                                       const gchar *source_urn,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data)
+{
+  GTask *task;
+  InsertSharedContentData *data;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gom_miner_insert_shared_content_async);
+
+  data = gom_insert_shared_content_data_new (self, account_id, shared_id, shared_type, source_urn);
+  g_task_set_task_data (task, data, (GDestroyNotify) gom_insert_shared_content_data_free);
+
+  gom_miner_when_ready (self, task, gom_miner_insert_shared_content_ready);
+  g_object_unref (task);
 }
 
 gboolean
@@ -885,33 +1829,279 @@ gom_miner_insert_shared_content_finish (GomMiner *self, GAsyncResult *res, GErro
   return g_task_propagate_boolean (task, error);
 }
 
-void
-gom_miner_refresh_db_async (GomMiner *self,
-                            GCancellable *cancellable,
-                            GAsyncReadyCallback callback,
-                            gpointer user_data)
+static void
+gom_miner_insert_shared_content_batch_in_thread_func (GTask *task,
+                                                      gpointer source_object,
+                                                      gpointer task_data,
+                                                      GCancellable *cancellable)
 {
-  GTask *task = NULL;
+  GomMiner *self = GOM_MINER (source_object);
+  GomMinerClass *klass = GOM_MINER_GET_CLASS (self);
+  InsertSharedContentBatchData *data = (InsertSharedContentBatchData *) task_data;
+  GHashTable *ensured_datasources;
+  GError *first_error;
+  GList *l;
 
-  task = g_task_new (self, cancellable, callback, user_data);
-  g_task_set_source_tag (task, gom_miner_refresh_db_async);
+  gom_governor_set_thread_level (GOM_GOVERNOR_LEVEL_INTERACTIVE);
 
-  if (self->priv->client_error != NULL)
+  first_error = data->error;
+  data->error = NULL;
+
+  ensured_datasources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* a failing group does not prevent the others from being imported,
+   * but the first error is reported back to the caller.
+   */
+  for (l = data->groups; l != NULL; l = l->next)
     {
-      g_task_return_error (task, g_error_copy (self->priv->client_error));
-      goto out;
+      SharedContentGroup *group = l->data;
+      GError *error = NULL;
+      gchar *datasource_urn;
+      guint idx;
+
+      datasource_urn = g_strdup_printf ("gd:goa-account:%s", group->account_id);
+
+      if (!g_hash_table_contains (ensured_datasources, datasource_urn))
+        {
+          gchar *root_element_urn;
+
+          root_element_urn = g_strdup_printf ("gd:goa-account:%s:root-element", group->account_id);
+          gom_miner_ensure_datasource (self, datasource_urn, root_element_urn, cancellable, &error);
+          g_free (root_element_urn);
+
+          if (error != NULL)
+            goto next;
+
+          g_hash_table_add (ensured_datasources, g_strdup (datasource_urn));
+        }
+
+      if (klass->insert_shared_content_batch != NULL)
+        {
+          klass->insert_shared_content_batch (self,
+                                              group->service,
+                                              self->priv->connection,
+                                              datasource_urn,
+                                              group->shared_type,
+                                              group->items,
+                                              cancellable,
+                                              &error);
+          goto next;
+        }
+
+      for (idx = 0; idx < group->items->len; idx++)
+        {
+          GomSharedContentItem *item = g_ptr_array_index (group->items, idx);
+          GError *item_error = NULL;
+
+          klass->insert_shared_content (self,
+                                        group->service,
+                                        self->priv->connection,
+                                        datasource_urn,
+                                        item->shared_id,
+                                        group->shared_type,
+                                        item->source_urn,
+                                        cancellable,
+                                        &item_error);
+          if (item_error != NULL)
+            {
+              g_warning ("Unable to insert shared content %s: %s", item->shared_id, item_error->message);
+              if (error == NULL)
+                error = item_error;
+              else
+                g_error_free (item_error);
+            }
+        }
+
+    next:
+      if (error != NULL)
+        {
+          if (first_error == NULL)
+            first_error = error;
+          else
+            g_error_free (error);
+        }
+
+      g_free (datasource_urn);
     }
 
-  if (self->priv->connection_error != NULL)
+  gom_governor_set_thread_level (GOM_GOVERNOR_LEVEL_BACKGROUND);
+
+  if (first_error != NULL)
+    g_task_return_error (task, first_error);
+  else
+    g_task_return_boolean (task, TRUE);
+
+  g_hash_table_unref (ensured_datasources);
+}
+
+static void
+gom_miner_insert_shared_content_batch_ready (GomMiner *self,
+                                             GTask *task)
+{
+  GHashTable *groups = NULL;
+  GVariantIter iter;
+  InsertSharedContentBatchData *data;
+  const gchar *account_id, *shared_id, *shared_type, *source_urn;
+
+  if (!gom_miner_check_initialized (self, task))
+    goto out;
+
+  if (GOM_MINER_GET_CLASS (self)->create_service == NULL
+      || (GOM_MINER_GET_CLASS (self)->insert_shared_content == NULL
+          && GOM_MINER_GET_CLASS (self)->insert_shared_content_batch == NULL))
     {
-      g_task_return_error (task, g_error_copy (self->priv->connection_error));
+      /* FIXME: use proper #defines and enumerated types */
+      g_task_return_new_error (task,
+                               g_quark_from_static_string ("gom-error"),
+                               0,
+                               "Shared content is not supported");
       goto out;
     }
 
-  gom_miner_refresh_db_real (self, task);
+  data = (InsertSharedContentBatchData *) g_task_get_task_data (task);
+  groups = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  g_variant_iter_init (&iter, data->items);
+  while (g_variant_iter_next (&iter, "(&s&s&s&s)", &account_id, &shared_id, &shared_type, &source_urn))
+    {
+      GomSharedContentItem *item;
+      SharedContentGroup *group;
+      gchar *key;
+
+      key = g_strdup_printf ("%s %s", account_id, shared_type);
+
+      /* already known not to resolve */
+      group = NULL;
+      if (g_hash_table_lookup_extended (groups, key, NULL, (gpointer *) &group) && group == NULL)
+        {
+          g_free (key);
+          continue;
+        }
+
+      if (group == NULL)
+        {
+          GoaObject *object;
+          GHashTable *services = NULL;
+          gpointer service = NULL;
+
+          object = goa_client_lookup_by_id (self->priv->client, account_id);
+          if (object != NULL)
+            {
+              if ((g_strcmp0 (shared_type, "documents") == 0 && goa_object_peek_documents (object) != NULL)
+                  || (g_strcmp0 (shared_type, "photos") == 0 && goa_object_peek_photos (object) != NULL))
+                service = gom_miner_create_service (self, object, shared_type, &services);
+
+              g_object_unref (object);
+            }
+
+          /* like a group that fails to import, this does not prevent
+           * the others from being imported
+           */
+          if (service == NULL)
+            {
+              g_warning ("Can not insert %s from account %s", shared_type, account_id);
+
+              /* FIXME: use proper #defines and enumerated types */
+              if (data->error == NULL)
+                data->error = g_error_new (g_quark_from_static_string ("gom-error"),
+                                           0,
+                                           "Can not insert %s from account %s",
+                                           shared_type, account_id);
+
+              g_hash_table_insert (groups, key, NULL);
+              continue;
+            }
+
+          group = gom_shared_content_group_new (account_id, shared_type, service, services);
+          if (services != NULL)
+            g_hash_table_unref (services);
+
+          data->groups = g_list_prepend (data->groups, group);
+          g_hash_table_insert (groups, key, group);
+        }
+      else
+        {
+          g_free (key);
+        }
+
+      item = g_slice_new0 (GomSharedContentItem);
+      item->shared_id = g_strdup (shared_id);
+      item->source_urn = g_strdup (source_urn);
+      g_ptr_array_add (group->items, item);
+    }
+
+  data->groups = g_list_reverse (data->groups);
+  g_task_set_priority (task, G_PRIORITY_HIGH);
+  g_task_run_in_thread (task, gom_miner_insert_shared_content_batch_in_thread_func);
 
  out:
-  g_clear_object (&task);
+  if (groups != NULL)
+    g_hash_table_unref (groups);
+}
+
+/* Like gom_miner_insert_shared_content_async, but for an a(ssss) array of
+ * (account_id, shared_id, shared_type, source_urn) items. A single
+ * service is created for each account and type, and the datasource of
+ * each account is only ensured once.
+ */
+void
+gom_miner_insert_shared_content_batch_async (GomMiner *self,
+                                             GVariant *items,
+                                             GCancellable *cancellable,
+                                             GAsyncReadyCallback callback,
+                                             gpointer user_data)
+{
+  GTask *task;
+  InsertSharedContentBatchData *data;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gom_miner_insert_shared_content_batch_async);
+
+  data = g_slice_new0 (InsertSharedContentBatchData);
+  data->self = g_object_ref (self);
+  data->items = g_variant_ref (items);
+  g_task_set_task_data (task, data, (GDestroyNotify) gom_insert_shared_content_batch_data_free);
+
+  gom_miner_when_ready (self, task, gom_miner_insert_shared_content_batch_ready);
+  g_object_unref (task);
+}
+
+gboolean
+gom_miner_insert_shared_content_batch_finish (GomMiner *self, GAsyncResult *res, GError **error)
+{
+  GTask *task;
+
+  g_assert (g_task_is_valid (res, self));
+  task = G_TASK (res);
+
+  g_assert (g_task_get_source_tag (task) == gom_miner_insert_shared_content_batch_async);
+
+  return g_task_propagate_boolean (task, error);
+}
+
+static void
+gom_miner_refresh_db_ready (GomMiner *self,
+                            GTask *task)
+{
+  if (!gom_miner_check_initialized (self, task))
+    return;
+
+  gom_miner_refresh_db_real (self, task);
+}
+
+void
+gom_miner_refresh_db_async (GomMiner *self,
+                            GCancellable *cancellable,
+                            GAsyncReadyCallback callback,
+                            gpointer user_data)
+{
+  GTask *task = NULL;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gom_miner_refresh_db_async);
+
+  gom_miner_when_ready (self, task, gom_miner_refresh_db_ready);
+  g_object_unref (task);
 }
 
 gboolean
@@ -929,9 +2119,30 @@ gom_miner_refresh_db_finish (GomMiner *self,
   return g_task_propagate_boolean (task, error);
 }
 
+static gboolean
+index_types_equal (const gchar **a, const gchar **b)
+{
+  guint i;
+
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  for (i = 0; a[i] != NULL && b[i] != NULL; i++)
+    {
+      if (g_strcmp0 (a[i], b[i]) != 0)
+        return FALSE;
+    }
+
+  return a[i] == NULL && b[i] == NULL;
+}
+
 void
 gom_miner_set_index_types (GomMiner *self, const char **index_types)
 {
+  /* create_services only creates the services for the indexed types */
+  if (!index_types_equal ((const gchar **) self->priv->index_types, index_types))
+    g_hash_table_remove_all (self->priv->services);
+
   g_strfreev (self->priv->index_types);
   self->priv->index_types = g_strdupv ((gchar **) index_types);
 }
@@ -70,8 +70,51 @@ typedef struct {
   GHashTable *previous_resources;
   gchar *datasource_urn;
   gchar *root_element_urn;
+
+  /* filled in while the job runs */
+  GomTrackerCounters counters;
+  guint64 bytes_fetched;
+  gint64 query_existing_usec;
+  gint64 query_usec;
+  gint64 cleanup_previous_usec;
 } GomAccountMinerJob;
 
+typedef struct {
+  gchar *shared_id;
+  gchar *source_urn;
+} GomSharedContentItem;
+
+/* Brings the data of a datasource from version - 1 to version in place,
+ * instead of deleting it and mining the account again. update is a
+ * SPARQL update in which every "{datasource}" is replaced by the URN of
+ * the datasource, which is also the graph of its data. refetch forgets
+ * the modification times, so that the next refresh writes the properties
+ * of every entry again.
+ */
+typedef struct {
+  gint version;
+  const gchar *update;
+  gboolean refetch;
+} GomMinerMigration;
+
+/* Contacts used to be created in the default graph and shared by all
+ * the accounts; now each account has its own, in its graph. This unlinks
+ * the old ones from the resources of the datasource and deletes those
+ * that nothing refers to any more; the refetch then links the resources
+ * to contacts in the graph.
+ */
+#define GOM_MINER_MIGRATION_CONTACTS_INTO_GRAPH                          \
+  "DELETE { ?urn ?property ?contact } WHERE { "                          \
+  "  GRAPH <{datasource}> { ?urn a nie:InformationElement } "            \
+  "  ?urn ?property ?contact . ?contact a nco:Contact . "               \
+  "  FILTER (NOT EXISTS { GRAPH <{datasource}> { ?contact a nco:Contact } }) " \
+  "} "                                                                   \
+  "DELETE { ?contact a rdfs:Resource } WHERE { "                         \
+  "  ?contact a nco:Contact ; nco:hasEmailAddress ?mail ; nco:fullname ?name . " \
+  "  FILTER (NOT EXISTS { GRAPH ?graph { ?contact a nco:Contact } }) "   \
+  "  FILTER (NOT EXISTS { ?other ?property ?contact }) "                 \
+  "}"
+
 struct _GomMiner
 {
   GObject parent;
@@ -87,6 +130,9 @@ struct _GomMinerClass
   char *miner_identifier;
   gint  version;
 
+  /* optional, terminated by an entry with a version of 0 */
+  const GomMinerMigration *migrations;
+
   gpointer (*create_service) (GomMiner *self, GoaObject *object, const gchar *type);
 
   GHashTable * (*create_services) (GomMiner *self,
@@ -104,6 +150,16 @@ struct _GomMinerClass
                                  GCancellable *cancellable,
                                  GError **error);
 
+  /* optional, falls back to insert_shared_content for each item */
+  void (*insert_shared_content_batch) (GomMiner *self,
+                                       gpointer service,
+                                       TrackerSparqlConnection *connection,
+                                       const gchar *datasource_urn,
+                                       const gchar *shared_type,
+                                       GPtrArray *items,
+                                       GCancellable *cancellable,
+                                       GError **error);
+
   void (*query) (GomAccountMinerJob *job,
                  TrackerSparqlConnection *connection,
                  GHashTable *previous_resources,
@@ -116,6 +172,15 @@ GType gom_miner_get_type (void);
 
 const gchar * gom_miner_get_display_name (GomMiner *self);
 
+void gom_miner_drop_caches (GomMiner *self);
+
+GVariant * gom_miner_dup_phases (GomMiner *self);
+
+GVariant * gom_miner_dup_metrics (GomMiner *self);
+
+void gom_account_miner_job_add_bytes_fetched (GomAccountMinerJob *job,
+                                              gsize n_bytes);
+
 void gom_miner_insert_shared_content_async (GomMiner *self,
                                             const gchar *account_id,
                                             const gchar *shared_id,
@@ -127,6 +192,14 @@ void gom_miner_insert_shared_content_async (GomMiner *self,
 
 gboolean gom_miner_insert_shared_content_finish (GomMiner *self, GAsyncResult *res, GError **error);
 
+void gom_miner_insert_shared_content_batch_async (GomMiner *self,
+                                                  GVariant *items,
+                                                  GCancellable *cancellable,
+                                                  GAsyncReadyCallback callback,
+                                                  gpointer user_data);
+
+gboolean gom_miner_insert_shared_content_batch_finish (GomMiner *self, GAsyncResult *res, GError **error);
+
 void gom_miner_refresh_db_async (GomMiner *self,
                                  GCancellable *cancellable,
                                  GAsyncReadyCallback callback,
@@ -26,6 +26,7 @@
 #include <goa/goa.h>
 
 #include "gom-owncloud-miner.h"
+#include "gom-trace.h"
 #include "gom-utils.h"
 
 #define MINER_IDENTIFIER "gd:owncloud:miner:8a409711-8fea-4eda-a417-f140ffc6d8f3"
@@ -107,7 +108,7 @@ account_miner_job_process_file (GomAccountMinerJob *job,
     goto out;
 
   gom_tracker_update_datasource (connection, datasource_urn,
-                                 resource_exists, identifier, resource,
+                                 resource_exists, resource,
                                  cancellable, error);
 
   if (*error != NULL)
@@ -117,7 +118,7 @@ account_miner_job_process_file (GomAccountMinerJob *job,
   modification_time = g_date_time_new_from_timeval_local (&tv);
   new_mtime = g_date_time_to_unix (modification_time);
   mtime_changed = gom_tracker_update_mtime (connection, new_mtime,
-                                            resource_exists, identifier, resource,
+                                            resource_exists, datasource_urn, resource,
                                             cancellable, error);
 
   if (*error != NULL)
@@ -243,6 +244,7 @@ account_miner_job_traverse_dir (GomAccountMinerJob *job,
       GFileType type;
       const gchar *name;
       gchar *uri;
+      gint64 trace;
 
       type = g_file_info_get_file_type (info);
       name = g_file_info_get_name (info);
@@ -250,6 +252,7 @@ account_miner_job_traverse_dir (GomAccountMinerJob *job,
 
       if (type == G_FILE_TYPE_REGULAR || type == G_FILE_TYPE_DIRECTORY)
         {
+          trace = gom_trace_begin ();
           account_miner_job_process_file (job,
                                           connection,
                                           previous_resources,
@@ -259,6 +262,7 @@ account_miner_job_traverse_dir (GomAccountMinerJob *job,
                                           is_root ? NULL : dir,
                                           cancellable,
                                           &local_error);
+          gom_trace_end (trace, "entry", "file");
           if (local_error != NULL)
             {
               uri = g_file_get_uri (child);
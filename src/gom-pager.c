@@ -0,0 +1,178 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "gom-pager.h"
+#include "gom-trace.h"
+
+struct _GomPager {
+  GThread *thread;
+  GMutex mutex;
+  GCond cond;
+
+  GQueue *pages;
+  GError *error;
+  guint depth;
+  gboolean done;
+  gboolean stopping;
+
+  GomPagerFunc func;
+  gpointer user_data;
+  GDestroyNotify page_destroy;
+  GCancellable *cancellable;
+
+  /* of the thread that created the pager, for tracing */
+  gchar *account_id;
+};
+
+static gpointer
+gom_pager_thread_func (gpointer data)
+{
+  GomPager *pager = data;
+  gboolean done;
+
+  gom_trace_set_thread_account (pager->account_id);
+
+  do
+    {
+      GError *error = NULL;
+      gpointer page;
+      gint64 trace;
+
+      /* the page about to be fetched counts towards @depth, so a fetch
+       * only starts while fewer than @depth pages are queued
+       */
+      g_mutex_lock (&pager->mutex);
+      while (g_queue_get_length (pager->pages) + 1 > pager->depth && !pager->stopping)
+        g_cond_wait (&pager->cond, &pager->mutex);
+
+      done = pager->stopping;
+      g_mutex_unlock (&pager->mutex);
+
+      if (done)
+        break;
+
+      trace = gom_trace_begin ();
+      page = pager->func (pager->user_data, pager->cancellable, &error);
+      gom_trace_end (trace, "fetch", "page");
+
+      g_mutex_lock (&pager->mutex);
+
+      if (page != NULL)
+        {
+          g_queue_push_tail (pager->pages, page);
+        }
+      else
+        {
+          pager->error = error;
+          pager->done = TRUE;
+        }
+
+      done = pager->done;
+      g_cond_broadcast (&pager->cond);
+      g_mutex_unlock (&pager->mutex);
+    }
+  while (!done);
+
+  return NULL;
+}
+
+/* Starts fetching pages with @func. At most @depth pages are held by the
+ * pager at any time, counting the queued ones and the one being fetched;
+ * the page last returned by gom_pager_next() belongs to the caller and
+ * is not counted.
+ */
+GomPager *
+gom_pager_new (guint depth,
+               GomPagerFunc func,
+               gpointer user_data,
+               GDestroyNotify page_destroy,
+               GCancellable *cancellable)
+{
+  GomPager *pager;
+
+  g_return_val_if_fail (func != NULL, NULL);
+
+  pager = g_slice_new0 (GomPager);
+  g_mutex_init (&pager->mutex);
+  g_cond_init (&pager->cond);
+  pager->pages = g_queue_new ();
+  pager->depth = MAX (depth, 1);
+  pager->func = func;
+  pager->user_data = user_data;
+  pager->page_destroy = page_destroy;
+  pager->cancellable = (cancellable != NULL) ? g_object_ref (cancellable) : NULL;
+  pager->account_id = g_strdup (gom_trace_get_thread_account ());
+
+  pager->thread = g_thread_new ("gom-pager", gom_pager_thread_func, pager);
+
+  return pager;
+}
+
+/* Blocks until the page following the previously returned one has been
+ * fetched, and transfers its ownership to the caller. Pages come out in
+ * the order in which the pager function produced them. Returns NULL at
+ * the end, or with @error set if fetching the page failed.
+ */
+gpointer
+gom_pager_next (GomPager *pager,
+                GError **error)
+{
+  gpointer page;
+
+  g_mutex_lock (&pager->mutex);
+
+  while (g_queue_is_empty (pager->pages) && !pager->done)
+    g_cond_wait (&pager->cond, &pager->mutex);
+
+  page = g_queue_pop_head (pager->pages);
+  if (page == NULL && pager->error != NULL)
+    {
+      g_propagate_error (error, pager->error);
+      pager->error = NULL;
+    }
+
+  g_cond_broadcast (&pager->cond);
+  g_mutex_unlock (&pager->mutex);
+
+  return page;
+}
+
+void
+gom_pager_free (GomPager *pager)
+{
+  g_mutex_lock (&pager->mutex);
+  pager->stopping = TRUE;
+  g_cond_broadcast (&pager->cond);
+  g_mutex_unlock (&pager->mutex);
+
+  g_thread_join (pager->thread);
+
+  g_queue_free_full (pager->pages, pager->page_destroy);
+  g_clear_error (&pager->error);
+  g_clear_object (&pager->cancellable);
+  g_free (pager->account_id);
+
+  g_mutex_clear (&pager->mutex);
+  g_cond_clear (&pager->cond);
+  g_slice_free (GomPager, pager);
+}
@@ -0,0 +1,51 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+#ifndef __GOM_PAGER_H__
+#define __GOM_PAGER_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GomPager GomPager;
+
+/* Fetches the next page, in a thread of its own. Returns NULL without
+ * setting @error once there are no more pages.
+ */
+typedef gpointer (*GomPagerFunc) (gpointer user_data,
+                                  GCancellable *cancellable,
+                                  GError **error);
+
+GomPager *gom_pager_new (guint depth,
+                         GomPagerFunc func,
+                         gpointer user_data,
+                         GDestroyNotify page_destroy,
+                         GCancellable *cancellable);
+
+gpointer gom_pager_next (GomPager *pager,
+                         GError **error);
+
+void gom_pager_free (GomPager *pager);
+
+G_END_DECLS
+
+#endif /* __GOM_PAGER_H__ */
@@ -0,0 +1,521 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+/* Records the D-Bus traffic between the miner and the services it talks
+ * to on the session bus, so that gom-replay can serve it back later.
+ * Each line of the file is a GOM_RECORDER_RECORD_TYPE tuple of:
+ *
+ *   kind        "call" or "signal"
+ *   name        well-known bus name of the peer
+ *   path, interface, member
+ *   args        body of the call or of the signal
+ *   reply       body of the reply, or the message of an error
+ *   error       D-Bus name of the error, or ""
+ *   offset      microseconds since the recording started
+ *   latency     microseconds between the call and its reply
+ *
+ * The bus daemon and the tracker store are left out.
+ *
+ * The HTTP requests that a miner makes itself, instead of through a
+ * service library, are recorded in the same file with gom_recorder_
+ * record_http(), as "http" lines where name is "", path is the URL
+ * without the credentials, interface is the method, reply is the
+ * payload as a bytestring or the message of an error, and error is
+ * "failed" for the latter. These are not served on the bus: with
+ * GOM_REPLAY_FILE set, the miner answers them from the recording
+ * itself through gom_recorder_replay_http(), right away and in the
+ * same order as gom-replay does for the calls.
+ *
+ * Only the Facebook photo pages are requested that way. libgdata,
+ * libzapojit and grilo do their own HTTP, which is not recorded.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "gom-recorder.h"
+
+typedef struct {
+  gchar *name;
+  gchar *path;
+  gchar *interface;
+  gchar *member;
+  GVariant *args;
+  gint64 time;
+  gboolean get_name_owner;
+} PendingCall;
+
+static FILE *record_file;
+static GMutex record_mutex;
+static gint64 record_epoch;
+
+/* serial of the call → PendingCall */
+static GHashTable *pending_calls;
+
+/* unique name → well-known name */
+static GHashTable *owners;
+
+/* "method URL" → GQueue of GVariant replies, see gom_recorder_replay_http() */
+static GHashTable *http_replies;
+
+static void
+pending_call_free (gpointer data)
+{
+  PendingCall *call = data;
+
+  g_free (call->name);
+  g_free (call->path);
+  g_free (call->interface);
+  g_free (call->member);
+  g_variant_unref (call->args);
+  g_slice_free (PendingCall, call);
+}
+
+static gboolean
+name_is_recorded (const gchar *name)
+{
+  return name != NULL
+    && g_strcmp0 (name, "org.freedesktop.DBus") != 0
+    && !g_str_has_prefix (name, "org.freedesktop.Tracker");
+}
+
+static GVariant *
+message_dup_body (GDBusMessage *message)
+{
+  GVariant *body;
+
+  body = g_dbus_message_get_body (message);
+  if (body == NULL)
+    return g_variant_ref_sink (g_variant_new_tuple (NULL, 0));
+
+  return g_variant_ref (body);
+}
+
+static void
+record_write (const gchar *kind,
+              const gchar *name,
+              const gchar *path,
+              const gchar *interface,
+              const gchar *member,
+              GVariant *args,
+              GVariant *reply,
+              const gchar *error,
+              gint64 offset,
+              gint64 latency)
+{
+  GVariant *record;
+  gchar *str;
+
+  record = g_variant_new ("(sssssvvsxx)",
+                          kind, name, path,
+                          (interface != NULL) ? interface : "",
+                          member, args, reply,
+                          (error != NULL) ? error : "",
+                          offset, latency);
+  str = g_variant_print (record, TRUE);
+  g_variant_unref (g_variant_ref_sink (record));
+
+  fprintf (record_file, "%s\n", str);
+  fflush (record_file);
+  g_free (str);
+}
+
+static void
+record_outgoing_call (GDBusMessage *message)
+{
+  PendingCall *call;
+  const gchar *destination;
+  const gchar *name;
+  gboolean get_name_owner = FALSE;
+
+  if (g_dbus_message_get_flags (message) & G_DBUS_MESSAGE_FLAGS_NO_REPLY_EXPECTED)
+    return;
+
+  destination = g_dbus_message_get_destination (message);
+  if (destination == NULL)
+    return;
+
+  /* proxies send their calls to the unique name of the owner, which
+   * they found out with GetNameOwner
+   */
+  if (g_strcmp0 (destination, "org.freedesktop.DBus") == 0)
+    {
+      if (g_strcmp0 (g_dbus_message_get_member (message), "GetNameOwner") != 0)
+        return;
+
+      get_name_owner = TRUE;
+      name = destination;
+    }
+  else if (destination[0] == ':')
+    {
+      name = g_hash_table_lookup (owners, destination);
+      if (name == NULL)
+        return;
+    }
+  else
+    {
+      name = destination;
+    }
+
+  if (!get_name_owner && !name_is_recorded (name))
+    return;
+
+  call = g_slice_new0 (PendingCall);
+  call->name = g_strdup (name);
+  call->path = g_strdup (g_dbus_message_get_path (message));
+  call->interface = g_strdup (g_dbus_message_get_interface (message));
+  call->member = g_strdup (g_dbus_message_get_member (message));
+  call->args = message_dup_body (message);
+  call->time = g_get_monotonic_time ();
+  call->get_name_owner = get_name_owner;
+
+  g_hash_table_insert (pending_calls,
+                       GUINT_TO_POINTER (g_dbus_message_get_serial (message)),
+                       call);
+}
+
+static void
+record_incoming_reply (GDBusMessage *message)
+{
+  PendingCall *call;
+  GVariant *reply;
+  gint64 now;
+  guint32 serial;
+
+  serial = g_dbus_message_get_reply_serial (message);
+  call = g_hash_table_lookup (pending_calls, GUINT_TO_POINTER (serial));
+  if (call == NULL)
+    return;
+
+  now = g_get_monotonic_time ();
+
+  if (call->get_name_owner)
+    {
+      const gchar *name, *owner;
+
+      if (g_dbus_message_get_message_type (message) == G_DBUS_MESSAGE_TYPE_METHOD_RETURN)
+        {
+          g_variant_get (call->args, "(&s)", &name);
+          g_variant_get (g_dbus_message_get_body (message), "(&s)", &owner);
+          g_hash_table_insert (owners, g_strdup (owner), g_strdup (name));
+        }
+    }
+  else if (g_dbus_message_get_message_type (message) == G_DBUS_MESSAGE_TYPE_ERROR)
+    {
+      GError *error = NULL;
+
+      g_dbus_message_to_gerror (message, &error);
+      reply = g_variant_new_string (error->message);
+      record_write ("call", call->name, call->path, call->interface, call->member,
+                    call->args, reply, g_dbus_message_get_error_name (message),
+                    call->time - record_epoch, now - call->time);
+      g_error_free (error);
+    }
+  else
+    {
+      reply = message_dup_body (message);
+      record_write ("call", call->name, call->path, call->interface, call->member,
+                    call->args, reply, NULL,
+                    call->time - record_epoch, now - call->time);
+      g_variant_unref (reply);
+    }
+
+  g_hash_table_remove (pending_calls, GUINT_TO_POINTER (serial));
+}
+
+static void
+record_incoming_signal (GDBusMessage *message)
+{
+  const gchar *name;
+  const gchar *sender;
+  GVariant *args;
+
+  sender = g_dbus_message_get_sender (message);
+  if (sender == NULL)
+    return;
+
+  if (g_strcmp0 (sender, "org.freedesktop.DBus") == 0)
+    {
+      const gchar *new_owner, *old_owner;
+
+      if (g_strcmp0 (g_dbus_message_get_member (message), "NameOwnerChanged") != 0)
+        return;
+
+      g_variant_get (g_dbus_message_get_body (message), "(&s&s&s)", &name, &old_owner, &new_owner);
+      if (name[0] != ':' && new_owner[0] != '\0')
+        g_hash_table_insert (owners, g_strdup (new_owner), g_strdup (name));
+
+      return;
+    }
+
+  name = g_hash_table_lookup (owners, sender);
+  if (!name_is_recorded (name))
+    return;
+
+  args = message_dup_body (message);
+  record_write ("signal", name,
+                g_dbus_message_get_path (message),
+                g_dbus_message_get_interface (message),
+                g_dbus_message_get_member (message),
+                args, g_variant_new_tuple (NULL, 0), NULL,
+                g_get_monotonic_time () - record_epoch, 0);
+  g_variant_unref (args);
+}
+
+/* Runs in the GDBus worker thread */
+static GDBusMessage *
+record_filter (GDBusConnection *connection,
+               GDBusMessage *message,
+               gboolean incoming,
+               gpointer user_data)
+{
+  g_mutex_lock (&record_mutex);
+
+  switch (g_dbus_message_get_message_type (message))
+    {
+    case G_DBUS_MESSAGE_TYPE_METHOD_CALL:
+      if (!incoming)
+        record_outgoing_call (message);
+      break;
+
+    case G_DBUS_MESSAGE_TYPE_METHOD_RETURN:
+    case G_DBUS_MESSAGE_TYPE_ERROR:
+      if (incoming)
+        record_incoming_reply (message);
+      break;
+
+    case G_DBUS_MESSAGE_TYPE_SIGNAL:
+      if (incoming)
+        record_incoming_signal (message);
+      break;
+
+    default:
+      break;
+    }
+
+  g_mutex_unlock (&record_mutex);
+
+  return message;
+}
+
+/* Starts recording the traffic on the session bus into @path, if it is
+ * not NULL. Meant to be called once, before any proxy is created.
+ */
+void
+gom_recorder_init (const gchar *path)
+{
+  GDBusConnection *connection;
+  GError *error = NULL;
+
+  if (path == NULL)
+    return;
+
+  g_return_if_fail (record_file == NULL);
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (connection == NULL)
+    {
+      g_warning ("Unable to record the session bus: %s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  record_file = fopen (path, "w");
+  if (record_file == NULL)
+    {
+      g_warning ("Unable to open record file %s: %s", path, g_strerror (errno));
+      g_object_unref (connection);
+      return;
+    }
+
+  record_epoch = g_get_monotonic_time ();
+  pending_calls = g_hash_table_new_full (NULL, NULL, NULL, pending_call_free);
+  owners = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  /* the filter, and the connection with it, stay for the life of the
+   * process
+   */
+  g_dbus_connection_add_filter (connection, record_filter, NULL, NULL);
+}
+
+/* Records an HTTP request to @url, sent at @time, with either the
+ * @payload of its reply or the @error it failed with. @url must not
+ * carry any credentials.
+ */
+void
+gom_recorder_record_http (const gchar *method,
+                          const gchar *url,
+                          GBytes *payload,
+                          const GError *error,
+                          gint64 time)
+{
+  GVariant *reply;
+
+  if (record_file == NULL)
+    return;
+
+  if (error != NULL)
+    reply = g_variant_new_string (error->message);
+  else
+    reply = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                       g_bytes_get_data (payload, NULL),
+                                       g_bytes_get_size (payload),
+                                       1);
+
+  g_mutex_lock (&record_mutex);
+  record_write ("http", "", url, method, "",
+                g_variant_new_tuple (NULL, 0), reply,
+                (error != NULL) ? "failed" : NULL,
+                time - record_epoch, g_get_monotonic_time () - time);
+  g_mutex_unlock (&record_mutex);
+}
+
+static void
+http_queue_free (gpointer data)
+{
+  g_queue_free_full (data, (GDestroyNotify) g_variant_unref);
+}
+
+/* Loads the "http" lines of the recording in @path, for
+ * gom_recorder_replay_http(), if it is not NULL.
+ */
+void
+gom_recorder_init_replay (const gchar *path)
+{
+  GError *error = NULL;
+  gchar *contents = NULL;
+  gchar **lines = NULL;
+  guint i;
+
+  if (path == NULL)
+    return;
+
+  g_return_if_fail (http_replies == NULL);
+
+  /* even if it can not be loaded, nothing goes to the network */
+  http_replies = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, http_queue_free);
+
+  if (!g_file_get_contents (path, &contents, NULL, &error))
+    goto out;
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i] != NULL; i++)
+    {
+      GVariant *record, *reply;
+      GQueue *queue;
+      const gchar *error_name, *kind, *method, *url;
+      gchar *key;
+
+      if (lines[i][0] == '\0')
+        continue;
+
+      record = g_variant_parse (GOM_RECORDER_RECORD_TYPE, lines[i], NULL, NULL, &error);
+      if (record == NULL)
+        {
+          g_prefix_error (&error, "%s:%u: ", path, i + 1);
+          goto out;
+        }
+
+      g_variant_get (record, "(&ss&s&ssv@v&sxx)",
+                     &kind, NULL, &url, &method, NULL, NULL, &reply, &error_name, NULL, NULL);
+
+      if (g_strcmp0 (kind, "http") == 0)
+        {
+          key = g_strdup_printf ("%s %s", method, url);
+          queue = g_hash_table_lookup (http_replies, key);
+          if (queue == NULL)
+            {
+              queue = g_queue_new ();
+              g_hash_table_insert (http_replies, key, queue);
+            }
+          else
+            {
+              g_free (key);
+            }
+
+          /* an error is kept as a string, a payload as bytes */
+          g_queue_push_tail (queue, g_variant_get_variant (reply));
+        }
+
+      g_variant_unref (reply);
+      g_variant_unref (record);
+    }
+
+ out:
+  if (error != NULL)
+    {
+      g_warning ("Unable to load the replay file %s: %s", path, error->message);
+      g_error_free (error);
+    }
+
+  g_strfreev (lines);
+  g_free (contents);
+}
+
+/* Returns FALSE if no recording is being replayed, and the request has
+ * to be sent. Otherwise, returns TRUE with either the recorded @payload
+ * or @error; a request missing from the recording fails.
+ */
+gboolean
+gom_recorder_replay_http (const gchar *method,
+                          const gchar *url,
+                          GBytes **payload,
+                          GError **error)
+{
+  GQueue *queue;
+  GVariant *reply;
+  gchar *key;
+
+  if (http_replies == NULL)
+    return FALSE;
+
+  key = g_strdup_printf ("%s %s", method, url);
+
+  g_mutex_lock (&record_mutex);
+
+  queue = g_hash_table_lookup (http_replies, key);
+  if (queue == NULL)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "%s is not in the recording", key);
+      goto out;
+    }
+
+  /* the last reply is kept for any later identical request */
+  if (g_queue_get_length (queue) > 1)
+    reply = g_queue_pop_head (queue);
+  else
+    reply = g_variant_ref (g_queue_peek_head (queue));
+
+  if (g_variant_is_of_type (reply, G_VARIANT_TYPE_STRING))
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED, g_variant_get_string (reply, NULL));
+  else
+    *payload = g_bytes_new (g_variant_get_data (reply), g_variant_get_size (reply));
+
+  g_variant_unref (reply);
+
+ out:
+  g_mutex_unlock (&record_mutex);
+  g_free (key);
+  return TRUE;
+}
@@ -0,0 +1,50 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+#ifndef __GOM_RECORDER_H__
+#define __GOM_RECORDER_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* One line of a recording, in the GVariant text format */
+#define GOM_RECORDER_RECORD_TYPE ((const GVariantType *) "(sssssvvsxx)")
+
+void gom_recorder_init (const gchar *path);
+
+void gom_recorder_record_http (const gchar *method,
+                               const gchar *url,
+                               GBytes *payload,
+                               const GError *error,
+                               gint64 time);
+
+void gom_recorder_init_replay (const gchar *path);
+
+gboolean gom_recorder_replay_http (const gchar *method,
+                                   const gchar *url,
+                                   GBytes **payload,
+                                   GError **error);
+
+G_END_DECLS
+
+#endif /* __GOM_RECORDER_H__ */
@@ -0,0 +1,477 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+/* Serves a recording made with GOM_RECORD_FILE back on the session bus,
+ * in place of the services that were recorded, so that a miner can be
+ * run against them offline, with GOM_REPLAY_FILE set to the same
+ * recording for the HTTP requests it makes itself. Calls are answered with the reply recorded
+ * for the same path, interface, member and arguments; when the same call
+ * was made several times, the replies are handed out in order and the
+ * last one is repeated. Signals are emitted at the time they were
+ * received during the recording.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "gom-recorder.h"
+
+typedef struct {
+  GVariant *reply;
+  gchar *error;
+  gint64 latency;
+} ReplayReply;
+
+typedef struct {
+  GDBusConnection *connection;
+  GDBusMessage *message;
+} ReplaySend;
+
+static gdouble speed = 1.0;
+static gchar **files = NULL;
+
+static GOptionEntry entries[] = {
+  { "speed", 's', 0, G_OPTION_ARG_DOUBLE, &speed,
+    "Speed factor of the replay, 0 answers without any delay (default: 1)", "FACTOR" },
+  { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &files, NULL, "FILE" },
+  { NULL }
+};
+
+/* key → GQueue of ReplayReply, only read once the replay started */
+static GHashTable *replies;
+
+/* of GVariant records, in the order they were received */
+static GPtrArray *signals;
+
+static GHashTable *names;
+static guint names_pending;
+static gint64 replay_epoch;
+
+static void
+replay_reply_free (gpointer data)
+{
+  ReplayReply *reply = data;
+
+  g_variant_unref (reply->reply);
+  g_free (reply->error);
+  g_slice_free (ReplayReply, reply);
+}
+
+static void
+replay_queue_free (gpointer data)
+{
+  g_queue_free_full (data, replay_reply_free);
+}
+
+static gchar *
+replay_key (const gchar *path,
+            const gchar *interface,
+            const gchar *member,
+            GVariant *args)
+{
+  gchar *key;
+  gchar *str;
+
+  str = g_variant_print (args, FALSE);
+  key = g_strdup_printf ("%s\n%s\n%s\n%s", path, (interface != NULL) ? interface : "", member, str);
+  g_free (str);
+
+  return key;
+}
+
+static gint64
+replay_scale (gint64 usec)
+{
+  if (speed <= 0)
+    return 0;
+
+  return (gint64) (usec / speed);
+}
+
+static gboolean
+replay_load (const gchar *path,
+             GError **error)
+{
+  gboolean retval = FALSE;
+  gchar *contents = NULL;
+  gchar **lines = NULL;
+  guint i;
+
+  if (!g_file_get_contents (path, &contents, NULL, error))
+    goto out;
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i] != NULL; i++)
+    {
+      GVariant *args, *record, *reply;
+      const gchar *error_name, *interface, *kind, *member, *name, *object_path;
+      gint64 latency, offset;
+
+      if (lines[i][0] == '\0')
+        continue;
+
+      record = g_variant_parse (GOM_RECORDER_RECORD_TYPE, lines[i], NULL, NULL, error);
+      if (record == NULL)
+        {
+          g_prefix_error (error, "%s:%u: ", path, i + 1);
+          goto out;
+        }
+
+      g_variant_get (record, "(&s&s&s&s&s@v@v&sxx)",
+                     &kind, &name, &object_path, &interface, &member,
+                     &args, &reply, &error_name, &offset, &latency);
+
+      /* the miner answers its HTTP requests itself */
+      if (g_strcmp0 (kind, "http") == 0)
+        goto next;
+
+      if (name[0] != ':' && !g_hash_table_contains (names, name))
+        g_hash_table_add (names, g_strdup (name));
+
+      if (g_strcmp0 (kind, "call") == 0)
+        {
+          ReplayReply *replay_reply;
+          GQueue *queue;
+          GVariant *call_args;
+          gchar *key;
+
+          call_args = g_variant_get_variant (args);
+          key = replay_key (object_path, interface, member, call_args);
+          g_variant_unref (call_args);
+
+          queue = g_hash_table_lookup (replies, key);
+          if (queue == NULL)
+            {
+              queue = g_queue_new ();
+              g_hash_table_insert (replies, key, queue);
+            }
+          else
+            {
+              g_free (key);
+            }
+
+          replay_reply = g_slice_new0 (ReplayReply);
+          replay_reply->reply = g_variant_get_variant (reply);
+          replay_reply->error = (error_name[0] != '\0') ? g_strdup (error_name) : NULL;
+          replay_reply->latency = latency;
+          g_queue_push_tail (queue, replay_reply);
+        }
+      else if (g_strcmp0 (kind, "signal") == 0)
+        {
+          g_ptr_array_add (signals, g_variant_ref (record));
+        }
+
+    next:
+      g_variant_unref (args);
+      g_variant_unref (reply);
+      g_variant_unref (record);
+    }
+
+  retval = TRUE;
+
+ out:
+  g_strfreev (lines);
+  g_free (contents);
+  return retval;
+}
+
+static gboolean
+replay_send_cb (gpointer user_data)
+{
+  ReplaySend *send = user_data;
+  GError *error = NULL;
+
+  if (!g_dbus_connection_send_message (send->connection, send->message,
+                                       G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, &error))
+    {
+      g_warning ("Unable to send a reply: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_object_unref (send->message);
+  g_object_unref (send->connection);
+  g_slice_free (ReplaySend, send);
+
+  return FALSE;
+}
+
+static void
+replay_send_later (GDBusConnection *connection,
+                   GDBusMessage *message,
+                   gint64 delay)
+{
+  GSource *source;
+  ReplaySend *send;
+
+  send = g_slice_new0 (ReplaySend);
+  send->connection = g_object_ref (connection);
+  send->message = message;
+
+  source = g_timeout_source_new ((guint) (delay / 1000));
+  g_source_set_callback (source, replay_send_cb, send, NULL);
+  g_source_attach (source, NULL);
+  g_source_unref (source);
+}
+
+/* Runs in the GDBus worker thread, and answers the calls from the
+ * recording there instead of dispatching them.
+ */
+static GDBusMessage *
+replay_filter (GDBusConnection *connection,
+               GDBusMessage *message,
+               gboolean incoming,
+               gpointer user_data)
+{
+  GDBusMessage *reply_message;
+  GQueue *queue;
+  GVariant *body;
+  ReplayReply *reply;
+  const gchar *interface;
+  gchar *key;
+
+  if (!incoming || g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL)
+    return message;
+
+  interface = g_dbus_message_get_interface (message);
+  if (g_strcmp0 (interface, "org.freedesktop.DBus.Peer") == 0
+      || g_strcmp0 (interface, "org.freedesktop.DBus.Introspectable") == 0)
+    return message;
+
+  body = g_dbus_message_get_body (message);
+  if (body == NULL)
+    body = g_variant_new_tuple (NULL, 0);
+
+  key = replay_key (g_dbus_message_get_path (message),
+                    interface,
+                    g_dbus_message_get_member (message),
+                    body);
+  g_variant_unref (g_variant_ref_sink (body));
+
+  queue = g_hash_table_lookup (replies, key);
+  g_free (key);
+
+  if (queue == NULL)
+    {
+      g_debug ("No recorded reply for %s.%s on %s",
+               interface,
+               g_dbus_message_get_member (message),
+               g_dbus_message_get_path (message));
+      reply_message = g_dbus_message_new_method_error_literal (message,
+                                                               "org.freedesktop.DBus.Error.UnknownMethod",
+                                                               "Not in the recording");
+      replay_send_later (connection, reply_message, 0);
+      g_object_unref (message);
+      return NULL;
+    }
+
+  /* the last reply is kept for any later identical call */
+  if (g_queue_get_length (queue) > 1)
+    reply = g_queue_pop_head (queue);
+  else
+    reply = g_queue_peek_head (queue);
+
+  if (reply->error != NULL)
+    {
+      reply_message = g_dbus_message_new_method_error_literal (message,
+                                                               reply->error,
+                                                               g_variant_get_string (reply->reply, NULL));
+    }
+  else
+    {
+      reply_message = g_dbus_message_new_method_reply (message);
+      if (g_variant_n_children (reply->reply) > 0)
+        g_dbus_message_set_body (reply_message, reply->reply);
+    }
+
+  replay_send_later (connection, reply_message, replay_scale (reply->latency));
+
+  if (g_queue_peek_head (queue) != reply)
+    replay_reply_free (reply);
+
+  g_object_unref (message);
+  return NULL;
+}
+
+static gboolean
+replay_emit_cb (gpointer user_data)
+{
+  GDBusConnection *connection = user_data;
+  GVariant *args, *parameters, *record;
+  const gchar *interface, *member, *object_path;
+  GError *error = NULL;
+  gint64 offset;
+  static guint next;
+
+  record = g_ptr_array_index (signals, next);
+  g_variant_get (record, "(ss&s&s&s@vvsxx)",
+                 NULL, NULL, &object_path, &interface, &member,
+                 &args, NULL, NULL, NULL, NULL);
+
+  parameters = g_variant_get_variant (args);
+  if (!g_dbus_connection_emit_signal (connection, NULL,
+                                      object_path, interface, member,
+                                      parameters, &error))
+    {
+      g_warning ("Unable to emit %s.%s: %s", interface, member, error->message);
+      g_clear_error (&error);
+    }
+
+  g_variant_unref (parameters);
+  g_variant_unref (args);
+
+  next++;
+  if (next >= signals->len)
+    return FALSE;
+
+  record = g_ptr_array_index (signals, next);
+  g_variant_get_child (record, 8, "x", &offset);
+  offset = replay_scale (offset) - (g_get_monotonic_time () - replay_epoch);
+  g_timeout_add ((guint) (MAX (offset, 0) / 1000), replay_emit_cb, connection);
+
+  return FALSE;
+}
+
+static void
+replay_start (GDBusConnection *connection)
+{
+  gint64 offset;
+
+  g_print ("Replaying %u calls and %u signals\n", g_hash_table_size (replies), signals->len);
+
+  replay_epoch = g_get_monotonic_time ();
+  if (signals->len == 0)
+    return;
+
+  g_variant_get_child (g_ptr_array_index (signals, 0), 8, "x", &offset);
+  g_timeout_add ((guint) (replay_scale (offset) / 1000), replay_emit_cb, connection);
+}
+
+static void
+replay_name_acquired_cb (GDBusConnection *connection,
+                         const gchar *name,
+                         gpointer user_data)
+{
+  g_debug ("Acquired %s", name);
+
+  names_pending--;
+  if (names_pending == 0)
+    replay_start (connection);
+}
+
+static void
+replay_name_lost_cb (GDBusConnection *connection,
+                     const gchar *name,
+                     gpointer user_data)
+{
+  g_printerr ("Unable to own %s, is the recorded service still running?\n", name);
+  g_main_loop_quit (user_data);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GDBusConnection *connection;
+  GError *error = NULL;
+  GHashTableIter iter;
+  GMainLoop *loop;
+  GOptionContext *context;
+  const gchar *name;
+  guint i;
+
+  context = g_option_context_new ("- serve a recording of the session bus");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (files == NULL)
+    {
+      g_printerr ("No recording given\n");
+      return 1;
+    }
+
+  replies = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, replay_queue_free);
+  signals = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+  names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (i = 0; files[i] != NULL; i++)
+    {
+      if (!replay_load (files[i], &error))
+        {
+          g_printerr ("Unable to load the recording: %s\n", error->message);
+          g_error_free (error);
+          return 1;
+        }
+    }
+
+  if (g_hash_table_size (names) == 0)
+    {
+      g_printerr ("Nothing to replay\n");
+      return 1;
+    }
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (connection == NULL)
+    {
+      g_printerr ("Unable to connect to the session bus: %s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  g_dbus_connection_add_filter (connection, replay_filter, NULL, NULL);
+
+  names_pending = g_hash_table_size (names);
+  g_hash_table_iter_init (&iter, names);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL))
+    {
+      g_bus_own_name_on_connection (connection, name,
+                                    G_BUS_NAME_OWNER_FLAGS_NONE,
+                                    replay_name_acquired_cb,
+                                    replay_name_lost_cb,
+                                    loop, NULL);
+    }
+
+  /* only quits if a name could not be owned */
+  g_main_loop_run (loop);
+
+  g_main_loop_unref (loop);
+  g_object_unref (connection);
+  g_hash_table_unref (names);
+  g_ptr_array_unref (signals);
+  g_hash_table_unref (replies);
+  g_strfreev (files);
+
+  return 1;
+}
@@ -0,0 +1,173 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+/* Writes a timeline of the spans of a refresh in the Trace Event
+ * Format, as a JSON array of complete events that chrome://tracing and
+ * Perfetto can load. The closing bracket is optional in that format, so
+ * the file is usable even if the miner does not exit cleanly.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "gom-trace.h"
+
+static FILE *trace_file;
+static GMutex trace_mutex;
+static gint64 trace_epoch;
+static gint last_tid;
+
+static GPrivate tid_key = G_PRIVATE_INIT (NULL);
+static GPrivate account_key = G_PRIVATE_INIT (g_free);
+
+/* Starts tracing into @path, if it is not NULL. Meant to be called once,
+ * before any other thread is running.
+ */
+void
+gom_trace_init (const gchar *path)
+{
+  if (path == NULL)
+    return;
+
+  g_return_if_fail (trace_file == NULL);
+
+  trace_file = fopen (path, "w");
+  if (trace_file == NULL)
+    {
+      g_warning ("Unable to open trace file %s: %s", path, g_strerror (errno));
+      return;
+    }
+
+  trace_epoch = g_get_monotonic_time ();
+  fputs ("[\n", trace_file);
+}
+
+/* Returns what has to be passed to gom_trace_end(), which is 0 when
+ * tracing is off.
+ */
+gint64
+gom_trace_begin (void)
+{
+  if (trace_file == NULL)
+    return 0;
+
+  return g_get_monotonic_time ();
+}
+
+static gint
+trace_get_tid (void)
+{
+  gint tid;
+
+  tid = GPOINTER_TO_INT (g_private_get (&tid_key));
+  if (tid == 0)
+    {
+      tid = g_atomic_int_add (&last_tid, 1) + 1;
+      g_private_set (&tid_key, GINT_TO_POINTER (tid));
+    }
+
+  return tid;
+}
+
+/* Appends @str as a JSON string, quotes included; g_strescape() is not
+ * enough, since JSON has no octal escapes.
+ */
+static void
+trace_append_json_string (GString *out,
+                          const gchar *str)
+{
+  const gchar *p;
+
+  g_string_append_c (out, '"');
+
+  for (p = (str != NULL) ? str : ""; *p != '\0'; p++)
+    {
+      guchar c = (guchar) *p;
+
+      if (c == '"' || c == '\\')
+        {
+          g_string_append_c (out, '\\');
+          g_string_append_c (out, c);
+        }
+      else if (c < 0x20)
+        {
+          g_string_append_printf (out, "\\u%04x", c);
+        }
+      else
+        {
+          g_string_append_c (out, c);
+        }
+    }
+
+  g_string_append_c (out, '"');
+}
+
+void
+gom_trace_end (gint64 begin,
+               const gchar *category,
+               const gchar *name)
+{
+  GString *event;
+  gint64 end;
+
+  if (begin == 0)
+    return;
+
+  end = g_get_monotonic_time ();
+
+  event = g_string_new ("{\"name\": ");
+  trace_append_json_string (event, name);
+  g_string_append (event, ", \"cat\": ");
+  trace_append_json_string (event, category);
+  g_string_append_printf (event,
+                          ", \"ph\": \"X\", \"ts\": %" G_GINT64_FORMAT ", \"dur\": %" G_GINT64_FORMAT ", "
+                          "\"pid\": %d, \"tid\": %d, \"args\": {\"account\": ",
+                          begin - trace_epoch, end - begin,
+                          (gint) getpid (), trace_get_tid ());
+  trace_append_json_string (event, gom_trace_get_thread_account ());
+  g_string_append (event, "}},\n");
+
+  g_mutex_lock (&trace_mutex);
+  fputs (event->str, trace_file);
+  fflush (trace_file);
+  g_mutex_unlock (&trace_mutex);
+
+  g_string_free (event, TRUE);
+}
+
+/* Tags the spans ended by this thread with @account_id, until it is
+ * set again; NULL clears it.
+ */
+void
+gom_trace_set_thread_account (const gchar *account_id)
+{
+  g_private_replace (&account_key, g_strdup (account_id));
+}
+
+const gchar *
+gom_trace_get_thread_account (void)
+{
+  return g_private_get (&account_key);
+}
@@ -0,0 +1,44 @@
+/*
+ * GNOME Online Miners - crawls through your online content
+ * Copyright (c) 2026 GNOME Online Miners contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ */
+
+
+#ifndef __GOM_TRACE_H__
+#define __GOM_TRACE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void gom_trace_init (const gchar *path);
+
+gint64 gom_trace_begin (void);
+
+void gom_trace_end (gint64 begin,
+                    const gchar *category,
+                    const gchar *name);
+
+void gom_trace_set_thread_account (const gchar *account_id);
+
+const gchar *gom_trace_get_thread_account (void);
+
+G_END_DECLS
+
+#endif /* __GOM_TRACE_H__ */
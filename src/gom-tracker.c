@@ -21,17 +21,964 @@
  *
  */
 
+#include <string.h>
+
 #include <glib.h>
 
+#include "gom-trace.h"
 #include "gom-tracker.h"
 #include "gom-utils.h"
 
+/* Resolved URNs of resources, contacts and equipment, so that a long
+ * lived miner does not have to look them up again on every refresh. It
+ * is a LRU bounded by an approximate size in bytes, shared by all the
+ * threads of the miner.
+ */
+typedef struct {
+  GList link;
+  gchar *key;
+  gchar *urn;
+  gsize size;
+} CacheEntry;
+
+static GMutex cache_mutex;
+static GHashTable *cache;
+static GQueue cache_lru = G_QUEUE_INIT;
+static gsize cache_size;
+static gsize cache_budget = GOM_TRACKER_CACHE_DEFAULT_BUDGET;
+
+static void
+cache_entry_free (gpointer data)
+{
+  CacheEntry *entry = data;
+
+  g_free (entry->key);
+  g_free (entry->urn);
+  g_slice_free (CacheEntry, entry);
+}
+
+static void
+cache_remove_entry_unlocked (CacheEntry *entry)
+{
+  g_queue_unlink (&cache_lru, &entry->link);
+  cache_size -= entry->size;
+  g_hash_table_remove (cache, entry->key);
+}
+
+static gchar *
+cache_lookup (const gchar *key)
+{
+  CacheEntry *entry;
+  gchar *retval = NULL;
+
+  g_mutex_lock (&cache_mutex);
+
+  if (cache == NULL)
+    goto out;
+
+  entry = g_hash_table_lookup (cache, key);
+  if (entry == NULL)
+    goto out;
+
+  g_queue_unlink (&cache_lru, &entry->link);
+  g_queue_push_head_link (&cache_lru, &entry->link);
+  retval = g_strdup (entry->urn);
+
+ out:
+  g_mutex_unlock (&cache_mutex);
+  return retval;
+}
+
+static void
+cache_insert (const gchar *key,
+              const gchar *urn)
+{
+  CacheEntry *entry;
+
+  g_mutex_lock (&cache_mutex);
+
+  if (cache_budget == 0)
+    goto out;
+
+  if (cache == NULL)
+    cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, cache_entry_free);
+
+  entry = g_hash_table_lookup (cache, key);
+  if (entry != NULL)
+    cache_remove_entry_unlocked (entry);
+
+  entry = g_slice_new0 (CacheEntry);
+  entry->link.data = entry;
+  entry->key = g_strdup (key);
+  entry->urn = g_strdup (urn);
+  entry->size = sizeof (CacheEntry) + strlen (key) + strlen (urn) + 2;
+
+  g_hash_table_insert (cache, entry->key, entry);
+  g_queue_push_head_link (&cache_lru, &entry->link);
+  cache_size += entry->size;
+
+  while (cache_size > cache_budget)
+    cache_remove_entry_unlocked (g_queue_peek_tail (&cache_lru));
+
+ out:
+  g_mutex_unlock (&cache_mutex);
+}
+
+/* Sets the approximate number of bytes the resolved URNs may use; 0
+ * disables the cache.
+ */
+void
+gom_tracker_cache_set_budget (gsize budget)
+{
+  g_mutex_lock (&cache_mutex);
+
+  cache_budget = budget;
+  while (cache_size > cache_budget)
+    cache_remove_entry_unlocked (g_queue_peek_tail (&cache_lru));
+
+  g_mutex_unlock (&cache_mutex);
+}
+
+/* Forgets the entries that resolve to one of @urns. Called with the
+ * URNs of resources deleted from the store, since the cache would
+ * otherwise hand them out again.
+ */
+static void
+cache_remove_urns (GHashTable *urns)
+{
+  GHashTableIter iter;
+  CacheEntry *entry;
+
+  g_mutex_lock (&cache_mutex);
+
+  if (cache == NULL)
+    goto out;
+
+  g_hash_table_iter_init (&iter, cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      if (!g_hash_table_contains (urns, entry->urn))
+        continue;
+
+      g_queue_unlink (&cache_lru, &entry->link);
+      cache_size -= entry->size;
+      g_hash_table_iter_remove (&iter);
+    }
+
+ out:
+  g_mutex_unlock (&cache_mutex);
+}
+
+/* Forgets the URNs that @sparql refers to. A cached URN is taken to mean
+ * that the resource exists, which might be why an update failed.
+ */
+static void
+cache_remove_referenced (const gchar *sparql)
+{
+  GHashTable *iris;
+  const gchar *start, *end;
+
+  iris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* a '<' in a FILTER or a literal only gives an IRI nothing resolves to */
+  for (start = strchr (sparql, '<'); start != NULL; start = strchr (end, '<'))
+    {
+      end = strchr (start + 1, '>');
+      if (end == NULL)
+        break;
+
+      g_hash_table_add (iris, g_strndup (start + 1, end - start - 1));
+    }
+
+  cache_remove_urns (iris);
+  g_hash_table_unref (iris);
+}
+
+/* Forgets the resources and contacts of @graph, once it was emptied or
+ * rewritten. The equipment is not tied to any graph.
+ */
+void
+gom_tracker_cache_remove_graph (const gchar *graph)
+{
+  GHashTableIter iter;
+  CacheEntry *entry;
+  gchar *prefix;
+
+  prefix = g_strconcat (graph, " ", NULL);
+
+  g_mutex_lock (&cache_mutex);
+
+  if (cache == NULL)
+    goto out;
+
+  g_hash_table_iter_init (&iter, cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      if (!g_str_has_prefix (entry->key, prefix))
+        continue;
+
+      g_queue_unlink (&cache_lru, &entry->link);
+      cache_size -= entry->size;
+      g_hash_table_iter_remove (&iter);
+    }
+
+ out:
+  g_mutex_unlock (&cache_mutex);
+  g_free (prefix);
+}
+
+/* Forgets all the resolved URNs, e.g. under memory pressure. */
+void
+gom_tracker_cache_clear (void)
+{
+  g_mutex_lock (&cache_mutex);
+
+  if (cache != NULL)
+    {
+      g_debug ("Dropping %u cached URNs (%" G_GSIZE_FORMAT " bytes)",
+               g_hash_table_size (cache), cache_size);
+
+      /* the entries are freed by the hash table */
+      g_queue_init (&cache_lru);
+      g_hash_table_remove_all (cache);
+      cache_size = 0;
+    }
+
+  g_mutex_unlock (&cache_mutex);
+}
+
+/* While a GomTrackerCounters is the thread default, the calls made to
+ * the store and what happened to the mined entries are counted in it.
+ */
+static GPrivate counters_key = G_PRIVATE_INIT (NULL);
+
+void
+gom_tracker_counters_push_thread_default (GomTrackerCounters *counters)
+{
+  g_return_if_fail (g_private_get (&counters_key) == NULL);
+  g_private_set (&counters_key, counters);
+}
+
+void
+gom_tracker_counters_pop_thread_default (GomTrackerCounters *counters)
+{
+  g_return_if_fail (g_private_get (&counters_key) == counters);
+  g_private_set (&counters_key, NULL);
+}
+
+static GomTrackerCounters *
+counters_get (void)
+{
+  return g_private_get (&counters_key);
+}
+
+static void
+count_query (void)
+{
+  GomTrackerCounters *counters = counters_get ();
+
+  if (counters != NULL)
+    counters->n_queries++;
+}
+
+static void
+count_update (void)
+{
+  GomTrackerCounters *counters = counters_get ();
+
+  if (counters != NULL)
+    counters->n_updates++;
+}
+
+/* Every call to the store goes through the wrappers below, which keep
+ * per call site statistics and log the slow ones. A call site is the
+ * function issuing the call, usually G_STRFUNC, and is not copied.
+ */
+typedef enum {
+  CALL_QUERY,
+  CALL_UPDATE,
+  N_CALL_KINDS
+} CallKind;
+
+static const gint64 latency_buckets[] = { 1000, 4000, 16000, 64000, 256000, 1000000, 4000000 };
+
+#define N_LATENCY_BUCKETS (G_N_ELEMENTS (latency_buckets) + 1)
+
+typedef struct {
+  const gchar *site;
+  guint n_calls;
+  guint n_errors;
+  guint64 n_bytes;
+  gint64 total_usec;
+  gint64 max_usec;
+  guint histogram[N_LATENCY_BUCKETS];
+} CallStats;
+
+static const gchar *call_kind_names[N_CALL_KINDS] = { "query", "update" };
+
+static GMutex stats_mutex;
+static GHashTable *stats[N_CALL_KINDS];
+static gint64 slow_threshold;
+
+static const gsize SLOW_LOG_MAX_LENGTH = 1024;
+
+static void
+stats_record (CallKind kind,
+              const gchar *site,
+              const gchar *sparql,
+              gint64 start,
+              gboolean failed)
+{
+  CallStats *call_stats;
+  gint64 usec;
+  gsize length;
+  guint i;
+
+  usec = g_get_monotonic_time () - start;
+  length = strlen (sparql);
+
+  g_mutex_lock (&stats_mutex);
+
+  if (stats[kind] == NULL)
+    stats[kind] = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+  call_stats = g_hash_table_lookup (stats[kind], site);
+  if (call_stats == NULL)
+    {
+      call_stats = g_new0 (CallStats, 1);
+      call_stats->site = site;
+      g_hash_table_insert (stats[kind], (gpointer) site, call_stats);
+    }
+
+  call_stats->n_calls++;
+  if (failed)
+    call_stats->n_errors++;
+  call_stats->n_bytes += length;
+  call_stats->total_usec += usec;
+  call_stats->max_usec = MAX (call_stats->max_usec, usec);
+
+  i = 0;
+  while (i < G_N_ELEMENTS (latency_buckets) && usec >= latency_buckets[i])
+    i++;
+
+  call_stats->histogram[i]++;
+
+  g_mutex_unlock (&stats_mutex);
+
+  if (slow_threshold > 0 && usec >= slow_threshold)
+    g_message ("Slow SPARQL %s in %s took %" G_GINT64_FORMAT " ms (%" G_GSIZE_FORMAT " bytes): %.*s%s",
+               call_kind_names[kind], site, usec / 1000, length,
+               (gint) MIN (length, SLOW_LOG_MAX_LENGTH), sparql,
+               (length > SLOW_LOG_MAX_LENGTH) ? "..." : "");
+}
+
+/* Calls taking at least @usec are logged; 0 turns it off. */
+void
+gom_tracker_stats_set_slow_threshold (gint64 usec)
+{
+  slow_threshold = usec;
+}
+
+static gint
+call_stats_compare (gconstpointer a,
+                    gconstpointer b)
+{
+  const CallStats *stats_a = a;
+  const CallStats *stats_b = b;
+
+  if (stats_a->total_usec == stats_b->total_usec)
+    return 0;
+
+  return (stats_a->total_usec < stats_b->total_usec) ? 1 : -1;
+}
+
+/* Logs the statistics of every call site, the most expensive first. The
+ * latency buckets are <1ms, <4ms, <16ms, <64ms, <256ms, <1s, <4s and
+ * the rest.
+ */
+void
+gom_tracker_stats_dump (void)
+{
+  guint kind;
+
+  g_mutex_lock (&stats_mutex);
+
+  for (kind = 0; kind < N_CALL_KINDS; kind++)
+    {
+      GList *l, *values;
+
+      if (stats[kind] == NULL)
+        continue;
+
+      values = g_list_sort (g_hash_table_get_values (stats[kind]), call_stats_compare);
+      for (l = values; l != NULL; l = l->next)
+        {
+          CallStats *call_stats = l->data;
+          GString *histogram;
+          guint i;
+
+          histogram = g_string_new (NULL);
+          for (i = 0; i < N_LATENCY_BUCKETS; i++)
+            g_string_append_printf (histogram, (i == 0) ? "%u" : "/%u", call_stats->histogram[i]);
+
+          g_message ("SPARQL %s in %s: %u calls, %u failed, %" G_GINT64_FORMAT " ms in total, "
+                     "%" G_GINT64_FORMAT " ms at most, %" G_GUINT64_FORMAT " bytes on average, "
+                     "latencies %s",
+                     call_kind_names[kind], call_stats->site,
+                     call_stats->n_calls, call_stats->n_errors,
+                     call_stats->total_usec / 1000, call_stats->max_usec / 1000,
+                     call_stats->n_bytes / call_stats->n_calls,
+                     histogram->str);
+
+          g_string_free (histogram, TRUE);
+        }
+
+      g_list_free (values);
+    }
+
+  g_mutex_unlock (&stats_mutex);
+}
+
+TrackerSparqlCursor *
+gom_tracker_sparql_connection_query (TrackerSparqlConnection *connection,
+                                     const gchar *site,
+                                     const gchar *sparql,
+                                     GCancellable *cancellable,
+                                     GError **error)
+{
+  GError *local_error = NULL;
+  TrackerSparqlCursor *cursor;
+  gint64 start;
+  gint64 trace;
+
+  count_query ();
+
+  trace = gom_trace_begin ();
+  start = g_get_monotonic_time ();
+  cursor = tracker_sparql_connection_query (connection, sparql, cancellable, &local_error);
+  stats_record (CALL_QUERY, site, sparql, start, local_error != NULL);
+  gom_trace_end (trace, "sparql-query", site);
+
+  if (local_error != NULL)
+    g_propagate_error (error, local_error);
+
+  return cursor;
+}
+
+void
+gom_tracker_sparql_connection_update (TrackerSparqlConnection *connection,
+                                      const gchar *site,
+                                      const gchar *sparql,
+                                      gint priority,
+                                      GCancellable *cancellable,
+                                      GError **error)
+{
+  GError *local_error = NULL;
+  gint64 start;
+  gint64 trace;
+
+  count_update ();
+
+  trace = gom_trace_begin ();
+  start = g_get_monotonic_time ();
+  tracker_sparql_connection_update (connection, sparql, priority, cancellable, &local_error);
+  stats_record (CALL_UPDATE, site, sparql, start, local_error != NULL);
+  gom_trace_end (trace, "sparql-update", site);
+
+  if (local_error != NULL)
+    {
+      /* nothing is wrong with the URNs if it was only cancelled */
+      if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        cache_remove_referenced (sparql);
+      g_propagate_error (error, local_error);
+    }
+}
+
+GVariant *
+gom_tracker_sparql_connection_update_blank (TrackerSparqlConnection *connection,
+                                            const gchar *site,
+                                            const gchar *sparql,
+                                            gint priority,
+                                            GCancellable *cancellable,
+                                            GError **error)
+{
+  GError *local_error = NULL;
+  GVariant *retval;
+  gint64 start;
+  gint64 trace;
+
+  count_update ();
+
+  trace = gom_trace_begin ();
+  start = g_get_monotonic_time ();
+  retval = tracker_sparql_connection_update_blank (connection, sparql, priority, cancellable, &local_error);
+  stats_record (CALL_UPDATE, site, sparql, start, local_error != NULL);
+  gom_trace_end (trace, "sparql-update", site);
+
+  if (local_error != NULL)
+    {
+      /* see gom_tracker_sparql_connection_update() */
+      if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        cache_remove_referenced (sparql);
+      g_propagate_error (error, local_error);
+    }
+
+  return retval;
+}
+
+/* Deletes resources in updates of at most batch_size of them, so that
+ * removing a lot of them neither builds a huge SPARQL string nor holds
+ * the store in a single long transaction.
+ */
+struct _GomTrackerDeleter {
+  TrackerSparqlConnection *connection;
+  GCancellable *cancellable;
+  GString *update;
+  GHashTable *pending;
+  gint priority;
+  guint batch_size;
+  guint n_pending;
+  guint n_deleted;
+};
+
+GomTrackerDeleter *
+gom_tracker_deleter_new (TrackerSparqlConnection *connection,
+                         guint batch_size,
+                         gint priority,
+                         GCancellable *cancellable)
+{
+  GomTrackerDeleter *deleter;
+
+  g_return_val_if_fail (batch_size > 0, NULL);
+
+  deleter = g_slice_new0 (GomTrackerDeleter);
+  deleter->connection = g_object_ref (connection);
+  deleter->cancellable = (cancellable != NULL) ? g_object_ref (cancellable) : NULL;
+  deleter->update = g_string_new (NULL);
+  deleter->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  deleter->priority = priority;
+  deleter->batch_size = batch_size;
+
+  return deleter;
+}
+
+/* Queues @resource for deletion, sending the pending batch once it is
+ * full.
+ */
+gboolean
+gom_tracker_deleter_add (GomTrackerDeleter *deleter,
+                         const gchar *resource,
+                         GError **error)
+{
+  if (deleter->n_pending == 0)
+    g_string_append (deleter->update, "DELETE { ");
+
+  g_string_append_printf (deleter->update, "<%s> a rdfs:Resource . ", resource);
+  g_hash_table_add (deleter->pending, g_strdup (resource));
+  deleter->n_pending++;
+
+  if (deleter->n_pending < deleter->batch_size)
+    return TRUE;
+
+  return gom_tracker_deleter_flush (deleter, error);
+}
+
+/* Sends the pending batch, if any. */
+gboolean
+gom_tracker_deleter_flush (GomTrackerDeleter *deleter,
+                           GError **error)
+{
+  GomTrackerCounters *counters;
+  GError *local_error = NULL;
+  guint n_pending;
+
+  if (deleter->n_pending == 0)
+    return TRUE;
+
+  g_string_append (deleter->update, "}");
+  n_pending = deleter->n_pending;
+
+  gom_tracker_sparql_connection_update (deleter->connection,
+                                        G_STRFUNC,
+                                        deleter->update->str,
+                                        deleter->priority,
+                                        deleter->cancellable,
+                                        &local_error);
+
+  g_string_truncate (deleter->update, 0);
+  deleter->n_pending = 0;
+
+  if (local_error != NULL)
+    {
+      g_hash_table_remove_all (deleter->pending);
+      g_propagate_error (error, local_error);
+      return FALSE;
+    }
+
+  /* only these are gone, a failed batch deleted nothing */
+  cache_remove_urns (deleter->pending);
+  g_hash_table_remove_all (deleter->pending);
+
+  deleter->n_deleted += n_pending;
+
+  counters = counters_get ();
+  if (counters != NULL)
+    counters->n_deleted += n_pending;
+
+  return TRUE;
+}
+
+guint
+gom_tracker_deleter_get_n_deleted (GomTrackerDeleter *deleter)
+{
+  return deleter->n_deleted;
+}
+
+/* Drops whatever was not flushed yet. */
+void
+gom_tracker_deleter_free (GomTrackerDeleter *deleter)
+{
+  g_object_unref (deleter->connection);
+  g_clear_object (&deleter->cancellable);
+  g_string_free (deleter->update, TRUE);
+  g_hash_table_unref (deleter->pending);
+  g_slice_free (GomTrackerDeleter, deleter);
+}
+
+/* Removes everything in the graph of @datasource_urn, @batch_size
+ * resources at a time, and then the datasource itself. Other updates get
+ * a chance to run between the batches, which a single graph-wide DELETE
+ * would not give them. Whole resources are deleted, so nothing shared
+ * with other accounts, like email addresses, may be put in the graph.
+ */
+gboolean
+gom_tracker_sparql_connection_delete_datasource (TrackerSparqlConnection *connection,
+                                                 GCancellable *cancellable,
+                                                 GError **error,
+                                                 const gchar *datasource_urn,
+                                                 guint batch_size,
+                                                 gint priority)
+{
+  GomTrackerDeleter *deleter;
+  GError *local_error = NULL;
+  TrackerSparqlCursor *cursor = NULL;
+  gboolean retval = FALSE;
+  gchar *select;
+  gchar *update = NULL;
+  guint n_rows;
+
+  deleter = gom_tracker_deleter_new (connection, batch_size, priority, cancellable);
+  /* the datasource and its root element live in the graph too, but have
+   * to go last
+   */
+  select = g_strdup_printf ("SELECT DISTINCT ?urn WHERE { GRAPH <%s> { ?urn a ?class } "
+                            "FILTER (?urn != <%s> && NOT EXISTS { ?urn nie:rootElementOf <%s> }) } "
+                            "LIMIT %u",
+                            datasource_urn, datasource_urn, datasource_urn, batch_size);
+
+  do
+    {
+      cursor = gom_tracker_sparql_connection_query (connection, G_STRFUNC, select, cancellable, &local_error);
+      if (local_error != NULL)
+        goto out;
+
+      n_rows = 0;
+      while (tracker_sparql_cursor_next (cursor, cancellable, &local_error))
+        {
+          if (!gom_tracker_deleter_add (deleter,
+                                        tracker_sparql_cursor_get_string (cursor, 0, NULL),
+                                        &local_error))
+            goto out;
+
+          n_rows++;
+        }
+
+      if (local_error != NULL)
+        goto out;
+
+      g_clear_object (&cursor);
+
+      if (!gom_tracker_deleter_flush (deleter, &local_error))
+        goto out;
+    }
+  while (n_rows == batch_size);
+
+  update = g_strdup_printf ("DELETE { ?root a rdfs:Resource } WHERE { ?root nie:rootElementOf <%s> } "
+                            "DELETE { <%s> a rdfs:Resource }",
+                            datasource_urn, datasource_urn);
+  gom_tracker_sparql_connection_update (connection, G_STRFUNC, update, priority, cancellable, &local_error);
+  if (local_error != NULL)
+    goto out;
+
+  g_debug ("Deleted %u resources of datasource %s",
+           gom_tracker_deleter_get_n_deleted (deleter), datasource_urn);
+  gom_tracker_cache_remove_graph (datasource_urn);
+  retval = TRUE;
+
+ out:
+  if (local_error != NULL)
+    g_propagate_error (error, local_error);
+
+  g_clear_object (&cursor);
+  gom_tracker_deleter_free (deleter);
+  g_free (select);
+  g_free (update);
+
+  return retval;
+}
+
+/* Removes everything in the graph of @datasource_urn, the datasource
+ * included, in a single statement. Unlike
+ * gom_tracker_sparql_connection_delete_datasource() it holds the store
+ * for as long as it takes, so it is for when the account is about to be
+ * mined again anyway.
+ */
+gboolean
+gom_tracker_sparql_connection_drop_datasource (TrackerSparqlConnection *connection,
+                                               GCancellable *cancellable,
+                                               GError **error,
+                                               const gchar *datasource_urn,
+                                               gint priority)
+{
+  GError *local_error = NULL;
+  gchar *update;
+
+  update = g_strdup_printf ("DELETE { ?urn a rdfs:Resource } WHERE { GRAPH <%s> { ?urn a ?class } }",
+                            datasource_urn);
+  gom_tracker_sparql_connection_update (connection, G_STRFUNC, update, priority, cancellable, &local_error);
+  g_free (update);
+
+  if (local_error != NULL)
+    {
+      g_propagate_error (error, local_error);
+      return FALSE;
+    }
+
+  gom_tracker_cache_remove_graph (datasource_urn);
+  return TRUE;
+}
+
+/* While a batch is the thread default, the updates below are queued and
+ * sent together, and new resources get a URN right away instead of
+ * being looked up first. It is only meant for filling an empty graph,
+ * since nothing queued can be read back before it is flushed, unless
+ * it was created with gom_tracker_batch_new_with_lookups().
+ */
+struct _GomTrackerBatch {
+  TrackerSparqlConnection *connection;
+  GCancellable *cancellable;
+  GString *update;
+  gboolean lookups;
+
+  /* cache key -> URN of the resources created by the batch; unlike the
+   * LRU these can not be evicted before they are in the store, and they
+   * only go to the LRU once they are
+   */
+  GHashTable *resources;
+
+  /* set by the first flush that failed: what was queued after it would
+   * link to resources that are not in the store
+   */
+  GError *error;
+};
+
+static GPrivate batch_key = G_PRIVATE_INIT (NULL);
+
+static const gsize BATCH_MAX_SIZE = 512 * 1024;
+
+GomTrackerBatch *
+gom_tracker_batch_new (TrackerSparqlConnection *connection,
+                       GCancellable *cancellable)
+{
+  GomTrackerBatch *batch;
+
+  batch = g_slice_new0 (GomTrackerBatch);
+  batch->connection = g_object_ref (connection);
+  batch->cancellable = (cancellable != NULL) ? g_object_ref (cancellable) : NULL;
+  batch->update = g_string_new (NULL);
+  batch->resources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  return batch;
+}
+
+/* Like gom_tracker_batch_new(), but resources are still looked up in the
+ * store before being created, and old values are still deleted, so that
+ * the graph does not need to be empty. Only the writes are batched.
+ */
+GomTrackerBatch *
+gom_tracker_batch_new_with_lookups (TrackerSparqlConnection *connection,
+                                    GCancellable *cancellable)
+{
+  GomTrackerBatch *batch;
+
+  batch = gom_tracker_batch_new (connection, cancellable);
+  batch->lookups = TRUE;
+
+  return batch;
+}
+
+/* Makes the gom_tracker_* functions called from this thread queue their
+ * updates in @batch, until gom_tracker_batch_pop_thread_default().
+ */
+void
+gom_tracker_batch_push_thread_default (GomTrackerBatch *batch)
+{
+  g_return_if_fail (g_private_get (&batch_key) == NULL);
+  g_private_set (&batch_key, batch);
+}
+
+void
+gom_tracker_batch_pop_thread_default (GomTrackerBatch *batch)
+{
+  g_return_if_fail (g_private_get (&batch_key) == batch);
+  g_private_set (&batch_key, NULL);
+}
+
+gboolean
+gom_tracker_batch_flush (GomTrackerBatch *batch,
+                         GError **error)
+{
+  GError *local_error = NULL;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  if (batch->error != NULL)
+    {
+      g_propagate_error (error, g_error_copy (batch->error));
+      return FALSE;
+    }
+
+  if (batch->update->len == 0)
+    return TRUE;
+
+  gom_tracker_sparql_connection_update (batch->connection,
+                                        G_STRFUNC,
+                                        batch->update->str,
+                                        G_PRIORITY_DEFAULT,
+                                        batch->cancellable,
+                                        &local_error);
+
+  g_debug ("Flushed %" G_GSIZE_FORMAT " bytes of batched updates", batch->update->len);
+  g_string_truncate (batch->update, 0);
+
+  if (local_error != NULL)
+    {
+      g_hash_table_remove_all (batch->resources);
+      batch->error = g_error_copy (local_error);
+      g_propagate_error (error, local_error);
+      return FALSE;
+    }
+
+  /* kept in the batch as well, since it does not look anything up */
+  g_hash_table_iter_init (&iter, batch->resources);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    cache_insert (key, value);
+
+  return TRUE;
+}
+
+/* Drops whatever was not flushed yet. */
+void
+gom_tracker_batch_free (GomTrackerBatch *batch)
+{
+  g_object_unref (batch->connection);
+  g_clear_object (&batch->cancellable);
+  g_string_free (batch->update, TRUE);
+  g_hash_table_unref (batch->resources);
+  g_clear_error (&batch->error);
+  g_slice_free (GomTrackerBatch, batch);
+}
+
+/* Sends @sparql, or queues it in the thread default batch. */
+static void
+gom_tracker_update (TrackerSparqlConnection *connection,
+                    const gchar *site,
+                    const gchar *sparql,
+                    GCancellable *cancellable,
+                    GError **error)
+{
+  GomTrackerBatch *batch;
+
+  batch = g_private_get (&batch_key);
+  if (batch == NULL)
+    {
+      gom_tracker_sparql_connection_update (connection, site, sparql, G_PRIORITY_DEFAULT, cancellable, error);
+      return;
+    }
+
+  if (batch->error != NULL)
+    {
+      g_propagate_error (error, g_error_copy (batch->error));
+      return;
+    }
+
+  g_string_append (batch->update, sparql);
+  g_string_append_c (batch->update, '\n');
+
+  if (batch->update->len >= BATCH_MAX_SIZE)
+    gom_tracker_batch_flush (batch, error);
+}
+
 static gchar *
 _tracker_utils_format_into_graph (const gchar *graph)
 {
   return (graph != NULL) ? g_strdup_printf ("INTO <%s> ", graph) : g_strdup ("");
 }
 
+/* Wraps @triples in a GRAPH block, so that they can be inserted along
+ * with others that do not belong to the graph.
+ */
+static gchar *
+_tracker_utils_format_in_graph (const gchar *graph,
+                                const gchar *triples)
+{
+  return (graph != NULL) ? g_strdup_printf ("GRAPH <%s> { %s }", graph, triples) : g_strdup (triples);
+}
+
+/* Returns the URN the batch already gave to @cache_key, or queues the
+ * creation of a new one with @triples, after the optional @extra ones,
+ * which are not put in @graph.
+ */
+static gchar *
+gom_tracker_batch_ensure_resource (GomTrackerBatch *batch,
+                                   GCancellable *cancellable,
+                                   GError **error,
+                                   const gchar *cache_key,
+                                   const gchar *graph,
+                                   const gchar *extra,
+                                   const gchar *triples)
+{
+  GError *local_error = NULL;
+  gchar *resource_triples;
+  gchar *graph_str;
+  gchar *insert;
+  gchar *retval;
+
+  retval = g_strdup (g_hash_table_lookup (batch->resources, cache_key));
+  if (retval != NULL)
+    return retval;
+
+  retval = tracker_sparql_get_uuid_urn ();
+
+  resource_triples = g_strdup_printf ("<%s> %s", retval, triples);
+  graph_str = _tracker_utils_format_in_graph (graph, resource_triples);
+  insert = g_strdup_printf ("INSERT { %s %s }", (extra != NULL) ? extra : "", graph_str);
+  gom_tracker_update (batch->connection, G_STRFUNC, insert, cancellable, &local_error);
+  g_free (resource_triples);
+  g_free (graph_str);
+  g_free (insert);
+
+  if (local_error != NULL)
+    {
+      g_propagate_error (error, local_error);
+      g_clear_pointer (&retval, g_free);
+      return NULL;
+    }
+
+  g_hash_table_insert (batch->resources, g_strdup (cache_key), g_strdup (retval));
+  return retval;
+}
+
 static gboolean
 gom_tracker_sparql_connection_get_string_attribute (TrackerSparqlConnection *connection,
                                                     GCancellable *cancellable,
@@ -47,9 +994,9 @@ gom_tracker_sparql_connection_get_string_attribute (TrackerSparqlConnection *con
 
   g_string_append_printf (select, "SELECT ?val { <%s> %s ?val }",
                           resource, attribute);
-  cursor = tracker_sparql_connection_query (connection,
-                                            select->str,
-                                            cancellable, error);
+  cursor = gom_tracker_sparql_connection_query (connection, G_STRFUNC,
+                                                select->str,
+                                                cancellable, error);
   g_string_free (select, TRUE);
 
   if (*error != NULL)
@@ -89,10 +1036,12 @@ gom_tracker_sparql_connection_ensure_resource (TrackerSparqlConnection *connecti
   GString *select, *insert, *inner;
   va_list args;
   const gchar *arg;
-  TrackerSparqlCursor *cursor;
+  TrackerSparqlCursor *cursor = NULL;
   gboolean res;
   gchar *retval = NULL;
+  gchar *cache_key;
   gchar *graph_str;
+  GomTrackerBatch *batch;
   GVariant *insert_res;
   GVariantIter *iter;
   gchar *key = NULL, *val = NULL;
@@ -109,14 +1058,39 @@ gom_tracker_sparql_connection_ensure_resource (TrackerSparqlConnection *connecti
 
   va_end (args);
 
+  /* each account owns the resources in its graph, even if another one
+   * has the same identifier
+   */
+  cache_key = g_strconcat ((graph != NULL) ? graph : "", " ", inner->str, NULL);
+
+  /* nothing is in the store yet, and what is queued can not be read */
+  batch = g_private_get (&batch_key);
+  if (batch != NULL && !batch->lookups)
+    {
+      retval = gom_tracker_batch_ensure_resource (batch, cancellable, error,
+                                                  cache_key, graph, NULL, inner->str);
+      goto out;
+    }
+
+  retval = cache_lookup (cache_key);
+  if (retval != NULL)
+    {
+      exists = TRUE;
+      goto out;
+    }
+
   /* query if such a resource is already in the DB */
   select = g_string_new (NULL);
-  g_string_append_printf (select,
-                          "SELECT ?urn WHERE { ?urn %s }", inner->str);
+  if (graph != NULL)
+    g_string_append_printf (select,
+                            "SELECT ?urn WHERE { GRAPH <%s> { ?urn %s } }", graph, inner->str);
+  else
+    g_string_append_printf (select,
+                            "SELECT ?urn WHERE { ?urn %s }", inner->str);
 
-  cursor = tracker_sparql_connection_query (connection,
-                                            select->str,
-                                            cancellable, error);
+  cursor = gom_tracker_sparql_connection_query (connection, G_STRFUNC,
+                                                select->str,
+                                                cancellable, error);
 
   g_string_free (select, TRUE);
 
@@ -134,21 +1108,28 @@ gom_tracker_sparql_connection_ensure_resource (TrackerSparqlConnection *connecti
       retval = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
       exists = TRUE;
       g_debug ("Found resource in the store: %s", retval);
+      cache_insert (cache_key, retval);
       goto out;
     }
 
   /* not found, create the resource */
+  if (batch != NULL)
+    {
+      retval = gom_tracker_batch_ensure_resource (batch, cancellable, error,
+                                                  cache_key, graph, NULL, inner->str);
+      goto out;
+    }
+
   insert = g_string_new (NULL);
   graph_str = _tracker_utils_format_into_graph (graph);
 
   g_string_append_printf (insert, "INSERT %s { _:res %s }",
                           graph_str, inner->str);
   g_free (graph_str);
-  g_string_free (inner, TRUE);
 
   insert_res =
-    tracker_sparql_connection_update_blank (connection, insert->str,
-                                            G_PRIORITY_DEFAULT, NULL, error);
+    gom_tracker_sparql_connection_update_blank (connection, G_STRFUNC, insert->str,
+                                                G_PRIORITY_DEFAULT, NULL, error);
 
   g_string_free (insert, TRUE);
 
@@ -175,8 +1156,12 @@ gom_tracker_sparql_connection_ensure_resource (TrackerSparqlConnection *connecti
     }
 
   g_debug ("Created a new resource: %s", retval);
+  cache_insert (cache_key, retval);
 
  out:
+  g_string_free (inner, TRUE);
+  g_free (cache_key);
+
   if (resource_exists)
     *resource_exists = exists;
 
@@ -214,9 +1199,69 @@ gom_tracker_sparql_connection_insert_or_replace_triple (TrackerSparqlConnection
 
   g_debug ("Insert or replace triple: query %s", insert->str);
 
-  tracker_sparql_connection_update (connection, insert->str,
-                                    G_PRIORITY_DEFAULT, cancellable,
-                                    error);
+  gom_tracker_update (connection, G_STRFUNC, insert->str, cancellable, error);
+
+  g_string_free (insert, TRUE);
+
+  if (*error != NULL)
+    retval = FALSE;
+
+  g_free (graph_str);
+
+  return retval;
+}
+
+/* Like gom_tracker_sparql_connection_insert_or_replace_triple, but sets
+ * all the properties of @resource in a single update. @properties holds
+ * pairs of property names and values; a NULL value unsets the property.
+ */
+gboolean
+gom_tracker_sparql_connection_insert_or_replace_properties (TrackerSparqlConnection *connection,
+                                                            GCancellable *cancellable,
+                                                            GError **error,
+                                                            const gchar *graph,
+                                                            const gchar *resource,
+                                                            GPtrArray *properties)
+{
+  GString *insert;
+  gchar *graph_str;
+  guint idx;
+  gboolean retval = TRUE;
+
+  g_return_val_if_fail (properties->len % 2 == 0, FALSE);
+
+  graph_str = _tracker_utils_format_into_graph (graph);
+
+  insert = g_string_new (NULL);
+  g_string_append_printf (insert,
+                          "INSERT OR REPLACE %s { <%s> a nie:InformationElement",
+                          graph_str, resource);
+
+  for (idx = 0; idx < properties->len; idx += 2)
+    {
+      const gchar *property_name = g_ptr_array_index (properties, idx);
+      const gchar *property_value = g_ptr_array_index (properties, idx + 1);
+
+      /* the "null" value must not be quoted */
+      if (property_value == NULL)
+        {
+          g_string_append_printf (insert, " ; %s null", property_name);
+        }
+      else
+        {
+          gchar *escaped;
+
+          escaped = tracker_sparql_escape_string (property_value);
+          g_string_append_printf (insert, " ; %s \"%s\"", property_name, escaped);
+          g_free (escaped);
+        }
+    }
+
+  g_string_append (insert, " }");
+
+  g_debug ("Insert or replace properties: query %s", insert->str);
+
+  gom_tracker_update (connection, G_STRFUNC, insert->str, cancellable, error);
 
   g_string_free (insert, TRUE);
 
@@ -237,24 +1282,30 @@ gom_tracker_sparql_connection_set_triple (TrackerSparqlConnection *connection,
                                           const gchar *property_name,
                                           const gchar *property_value)
 {
+  GomTrackerBatch *batch;
   GString *delete;
   gboolean retval = TRUE;
 
-  delete = g_string_new (NULL);
-  g_string_append_printf
-    (delete,
-     "DELETE { <%s> %s ?val } WHERE { <%s> %s ?val }", resource,
-     property_name, resource, property_name);
+  /* a batch only creates new resources, there is no old value, unless
+   * it looks them up
+   */
+  batch = g_private_get (&batch_key);
+  if (batch == NULL || batch->lookups)
+    {
+      delete = g_string_new (NULL);
+      g_string_append_printf
+        (delete,
+         "DELETE { <%s> %s ?val } WHERE { <%s> %s ?val }", resource,
+         property_name, resource, property_name);
 
-  tracker_sparql_connection_update (connection, delete->str,
-                                    G_PRIORITY_DEFAULT, cancellable,
-                                    error);
+      gom_tracker_update (connection, G_STRFUNC, delete->str, cancellable, error);
 
-  g_string_free (delete, TRUE);
-  if (*error != NULL)
-    {
-      retval = FALSE;
-      goto out;
+      g_string_free (delete, TRUE);
+      if (*error != NULL)
+        {
+          retval = FALSE;
+          goto out;
+        }
     }
 
   retval =
@@ -291,9 +1342,7 @@ gom_tracker_sparql_connection_toggle_favorite (TrackerSparqlConnection *connecti
 
   g_debug ("Toggle favorite: query %s", update->str);
 
-  tracker_sparql_connection_update (connection, update->str,
-                                    G_PRIORITY_DEFAULT, cancellable,
-                                    error);
+  gom_tracker_update (connection, G_STRFUNC, update->str, cancellable, error);
 
   g_string_free (update, TRUE);
 
@@ -307,27 +1356,66 @@ gchar*
 gom_tracker_utils_ensure_contact_resource (TrackerSparqlConnection *connection,
                                            GCancellable *cancellable,
                                            GError **error,
+                                           const gchar *graph,
                                            const gchar *email,
                                            const gchar *fullname)
 {
   GString *select, *insert;
   TrackerSparqlCursor *cursor = NULL;
   gchar *retval = NULL, *mail_uri = NULL;
+  gchar *cache_key = NULL;
+  gchar *contact_triples;
+  gchar *graph_str = NULL;
+  GomTrackerBatch *batch;
   gboolean res;
   GVariant *insert_res;
   GVariantIter *iter;
   gchar *key = NULL, *val = NULL;
 
   mail_uri = g_strconcat ("mailto:", email, NULL);
+
+  /* contacts are created in, and only looked up from, the graph of the
+   * account, so that they go away with it; the email address is not,
+   * since its IRI is shared with the other accounts and tracker's own
+   * miners, and purging the graph would delete it for all of them
+   */
+  cache_key = g_strconcat ((graph != NULL) ? graph : "", " ", mail_uri, NULL);
+
+  batch = g_private_get (&batch_key);
+  if (batch != NULL && !batch->lookups)
+    {
+      gchar *email_triples;
+
+      email_triples = g_strdup_printf ("<%s> a nco:EmailAddress ; nco:emailAddress \"%s\" . ",
+                                       mail_uri, email);
+      contact_triples = g_strdup_printf ("a nco:Contact ; nco:hasEmailAddress <%s> ; nco:fullname \"%s\" .",
+                                         mail_uri, fullname);
+      retval = gom_tracker_batch_ensure_resource (batch, cancellable, error,
+                                                  cache_key, graph, email_triples, contact_triples);
+      g_free (email_triples);
+      g_free (contact_triples);
+      goto out;
+    }
+
+  retval = cache_lookup (cache_key);
+  if (retval != NULL)
+    goto out;
+
   select = g_string_new (NULL);
-  g_string_append_printf (select,
-                          "SELECT ?urn WHERE { ?urn a nco:Contact . "
-                          "?urn nco:hasEmailAddress ?mail . "
-                          "FILTER (fn:contains(?mail, \"%s\" )) }", mail_uri);
+  if (graph != NULL)
+    g_string_append_printf (select,
+                            "SELECT ?urn WHERE { GRAPH <%s> { ?urn a nco:Contact . "
+                            "?urn nco:hasEmailAddress ?mail . "
+                            "FILTER (fn:contains(?mail, \"%s\" )) } }", graph, mail_uri);
+  else
+    g_string_append_printf (select,
+                            "SELECT ?urn WHERE { ?urn a nco:Contact . "
+                            "?urn nco:hasEmailAddress ?mail . "
+                            "FILTER (fn:contains(?mail, \"%s\" )) }", mail_uri);
 
-  cursor = tracker_sparql_connection_query (connection,
-                                            select->str,
-                                            cancellable, error);
+  cursor = gom_tracker_sparql_connection_query (connection, G_STRFUNC,
+                                                select->str,
+                                                cancellable, error);
 
   g_string_free (select, TRUE);
 
@@ -344,21 +1432,40 @@ gom_tracker_utils_ensure_contact_resource (TrackerSparqlConnection *connection,
       /* return the found resource */
       retval = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
       g_debug ("Found resource in the store: %s", retval);
+      cache_insert (cache_key, retval);
       goto out;
     }
 
   /* not found, create the resource */
+  if (batch != NULL)
+    {
+      gchar *email_triples;
+
+      email_triples = g_strdup_printf ("<%s> a nco:EmailAddress ; nco:emailAddress \"%s\" . ",
+                                       mail_uri, email);
+      contact_triples = g_strdup_printf ("a nco:Contact ; nco:hasEmailAddress <%s> ; nco:fullname \"%s\" .",
+                                         mail_uri, fullname);
+      retval = gom_tracker_batch_ensure_resource (batch, cancellable, error,
+                                                  cache_key, graph, email_triples, contact_triples);
+      g_free (email_triples);
+      g_free (contact_triples);
+      goto out;
+    }
+
   insert = g_string_new (NULL);
+  contact_triples = g_strdup_printf ("_:res a nco:Contact ; nco:hasEmailAddress <%s> ; nco:fullname \"%s\" .",
+                                     mail_uri, fullname);
+  graph_str = _tracker_utils_format_in_graph (graph, contact_triples);
+  g_free (contact_triples);
 
   g_string_append_printf (insert,
-                          "INSERT { <%s> a nco:EmailAddress ; nco:emailAddress \"%s\" . "
-                          "_:res a nco:Contact ; nco:hasEmailAddress <%s> ; nco:fullname \"%s\" . }",
+                          "INSERT { <%s> a nco:EmailAddress ; nco:emailAddress \"%s\" . %s }",
                           mail_uri, email,
-                          mail_uri, fullname);
+                          graph_str);
 
   insert_res =
-    tracker_sparql_connection_update_blank (connection, insert->str,
-                                            G_PRIORITY_DEFAULT, cancellable, error);
+    gom_tracker_sparql_connection_update_blank (connection, G_STRFUNC, insert->str,
+                                                G_PRIORITY_DEFAULT, cancellable, error);
 
   g_string_free (insert, TRUE);
 
@@ -385,9 +1492,12 @@ gom_tracker_utils_ensure_contact_resource (TrackerSparqlConnection *connection,
     }
 
   g_debug ("Created a new contact resource: %s", retval);
+  cache_insert (cache_key, retval);
 
  out:
   g_clear_object (&cursor);
+  g_free (cache_key);
+  g_free (graph_str);
   g_free (mail_uri);
 
   return retval;
@@ -401,6 +1511,7 @@ gom_tracker_utils_ensure_equipment_resource (TrackerSparqlConnection *connection
                                              const gchar *model)
 {
   GError *local_error;
+  GomTrackerBatch *batch;
   TrackerSparqlCursor *cursor = NULL;
   gboolean res;
   gchar *equip_uri = NULL;
@@ -413,13 +1524,30 @@ gom_tracker_utils_ensure_equipment_resource (TrackerSparqlConnection *connection
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
   g_return_val_if_fail (make != NULL || model != NULL, NULL);
 
+  /* unlike contacts, equipment is not tied to an account: the URN only
+   * depends on the make and the model, and other miners use it too
+   */
   equip_uri = tracker_sparql_escape_uri_printf ("urn:equipment:%s:%s:",
                                                 make != NULL ? make : "",
                                                 model != NULL ? model : "");
+
+  /* it might be queued, but not in the store yet */
+  batch = g_private_get (&batch_key);
+  if (batch != NULL)
+    {
+      retval = g_strdup (g_hash_table_lookup (batch->resources, equip_uri));
+      if (retval != NULL)
+        goto out;
+    }
+
+  retval = cache_lookup (equip_uri);
+  if (retval != NULL)
+    goto out;
+
   select = g_strdup_printf ("SELECT <%s> WHERE { }", equip_uri);
 
   local_error = NULL;
-  cursor = tracker_sparql_connection_query (connection, select, cancellable, &local_error);
+  cursor = gom_tracker_sparql_connection_query (connection, G_STRFUNC, select, cancellable, &local_error);
   if (local_error != NULL)
     {
       g_propagate_error (error, local_error);
@@ -444,6 +1572,7 @@ gom_tracker_utils_ensure_equipment_resource (TrackerSparqlConnection *connection
           /* return the found resource */
           retval = g_strdup (cursor_uri);
           g_debug ("Found resource in the store: %s", retval);
+          cache_insert (equip_uri, retval);
           goto out;
         }
     }
@@ -455,7 +1584,7 @@ gom_tracker_utils_ensure_equipment_resource (TrackerSparqlConnection *connection
                             model);
 
   local_error = NULL;
-  tracker_sparql_connection_update (connection, insert, G_PRIORITY_DEFAULT, cancellable, &local_error);
+  gom_tracker_update (connection, G_STRFUNC, insert, cancellable, &local_error);
   if (local_error != NULL)
     {
       g_propagate_error (error, local_error);
@@ -466,6 +1595,10 @@ gom_tracker_utils_ensure_equipment_resource (TrackerSparqlConnection *connection
   equip_uri = NULL;
 
   g_debug ("Created a new equipment resource: %s", retval);
+  if (batch != NULL)
+    g_hash_table_insert (batch->resources, g_strdup (retval), g_strdup (retval));
+  else
+    cache_insert (retval, retval);
 
  out:
   g_clear_object (&cursor);
@@ -480,13 +1613,17 @@ void
 gom_tracker_update_datasource (TrackerSparqlConnection  *connection,
                                const gchar              *datasource_urn,
                                gboolean                  resource_exists,
-                               const gchar              *identifier,
                                const gchar              *resource,
                                GCancellable             *cancellable,
                                GError                  **error)
 {
+  GomTrackerCounters *counters;
   gboolean set_datasource;
 
+  counters = counters_get ();
+  if (counters != NULL)
+    counters->n_seen++;
+
   /* only set the datasource again if it has changed; this avoids touching the
    * DB completely if the entry didn't change at all, since we later also check
    * the mtime. */
@@ -514,7 +1651,7 @@ gom_tracker_update_datasource (TrackerSparqlConnection  *connection,
   if (set_datasource)
     gom_tracker_sparql_connection_set_triple
       (connection, cancellable, error,
-       identifier, resource,
+       datasource_urn, resource,
        "nie:dataSource", datasource_urn);
 }
 
@@ -522,11 +1659,12 @@ gboolean
 gom_tracker_update_mtime (TrackerSparqlConnection  *connection,
                           gint64                    new_mtime,
                           gboolean                  resource_exists,
-                          const gchar              *identifier,
+                          const gchar              *graph,
                           const gchar              *resource,
                           GCancellable             *cancellable,
                           GError                  **error)
 {
+  GomTrackerCounters *counters;
   GTimeVal old_mtime;
   gboolean res;
   gchar *old_value;
@@ -552,9 +1690,13 @@ gom_tracker_update_mtime (TrackerSparqlConnection  *connection,
   date = gom_iso8601_from_timestamp (new_mtime);
   gom_tracker_sparql_connection_insert_or_replace_triple
     (connection, cancellable, error,
-     identifier, resource,
+     graph, resource,
      "nie:contentLastModified", date);
   g_free (date);
 
+  counters = counters_get ();
+  if (counters != NULL)
+    counters->n_changed++;
+
   return TRUE;
 }
@@ -29,6 +29,59 @@
 
 G_BEGIN_DECLS
 
+#define GOM_TRACKER_CACHE_DEFAULT_BUDGET (4 * 1024 * 1024)
+
+#define GOM_TRACKER_DELETER_DEFAULT_BATCH_SIZE 500
+
+typedef struct _GomTrackerBatch GomTrackerBatch;
+typedef struct _GomTrackerDeleter GomTrackerDeleter;
+
+/* seen and changed are the entries passed to
+ * gom_tracker_update_datasource() and those whose modification time
+ * was written by gom_tracker_update_mtime()
+ */
+typedef struct {
+  guint n_queries;
+  guint n_updates;
+  guint n_seen;
+  guint n_changed;
+  guint n_deleted;
+} GomTrackerCounters;
+
+void gom_tracker_cache_set_budget (gsize budget);
+
+void gom_tracker_cache_remove_graph (const gchar *graph);
+
+void gom_tracker_cache_clear (void);
+
+void gom_tracker_counters_push_thread_default (GomTrackerCounters *counters);
+
+void gom_tracker_counters_pop_thread_default (GomTrackerCounters *counters);
+
+void gom_tracker_stats_set_slow_threshold (gint64 usec);
+
+void gom_tracker_stats_dump (void);
+
+TrackerSparqlCursor *gom_tracker_sparql_connection_query (TrackerSparqlConnection *connection,
+                                                          const gchar *site,
+                                                          const gchar *sparql,
+                                                          GCancellable *cancellable,
+                                                          GError **error);
+
+void gom_tracker_sparql_connection_update (TrackerSparqlConnection *connection,
+                                           const gchar *site,
+                                           const gchar *sparql,
+                                           gint priority,
+                                           GCancellable *cancellable,
+                                           GError **error);
+
+GVariant *gom_tracker_sparql_connection_update_blank (TrackerSparqlConnection *connection,
+                                                      const gchar *site,
+                                                      const gchar *sparql,
+                                                      gint priority,
+                                                      GCancellable *cancellable,
+                                                      GError **error);
+
 gchar *gom_tracker_sparql_connection_ensure_resource (TrackerSparqlConnection *connection,
                                                       GCancellable *cancellable,
                                                       GError **error,
@@ -46,6 +99,13 @@ gboolean gom_tracker_sparql_connection_insert_or_replace_triple (TrackerSparqlCo
                                                                  const gchar *property_name,
                                                                  const gchar *property_value);
 
+gboolean gom_tracker_sparql_connection_insert_or_replace_properties (TrackerSparqlConnection *connection,
+                                                                     GCancellable *cancellable,
+                                                                     GError **error,
+                                                                     const gchar *graph,
+                                                                     const gchar *resource,
+                                                                     GPtrArray *properties);
+
 gboolean gom_tracker_sparql_connection_set_triple (TrackerSparqlConnection *connection,
                                                    GCancellable *cancellable,
                                                    GError **error,
@@ -63,6 +123,7 @@ gboolean gom_tracker_sparql_connection_toggle_favorite (TrackerSparqlConnection
 gchar* gom_tracker_utils_ensure_contact_resource (TrackerSparqlConnection *connection,
                                                   GCancellable *cancellable,
                                                   GError **error,
+                                                  const gchar *graph,
                                                   const gchar *email,
                                                   const gchar *fullname);
 
@@ -75,18 +136,61 @@ gchar *gom_tracker_utils_ensure_equipment_resource (TrackerSparqlConnection *con
 void gom_tracker_update_datasource (TrackerSparqlConnection  *connection,
                                     const gchar              *datasource_urn,
                                     gboolean                  resource_exists,
-                                    const gchar              *identifier,
                                     const gchar              *resource,
                                     GCancellable             *cancellable,
                                     GError                  **error);
 gboolean gom_tracker_update_mtime (TrackerSparqlConnection  *connection,
                                    gint64                    new_mtime,
                                    gboolean                  resource_exists,
-                                   const gchar              *identifier,
+                                   const gchar              *graph,
                                    const gchar              *resource,
                                    GCancellable             *cancellable,
                                    GError                  **error);
 
+GomTrackerBatch *gom_tracker_batch_new (TrackerSparqlConnection *connection,
+                                        GCancellable *cancellable);
+
+GomTrackerBatch *gom_tracker_batch_new_with_lookups (TrackerSparqlConnection *connection,
+                                                     GCancellable *cancellable);
+
+void gom_tracker_batch_push_thread_default (GomTrackerBatch *batch);
+
+void gom_tracker_batch_pop_thread_default (GomTrackerBatch *batch);
+
+gboolean gom_tracker_batch_flush (GomTrackerBatch *batch,
+                                  GError **error);
+
+void gom_tracker_batch_free (GomTrackerBatch *batch);
+
+GomTrackerDeleter *gom_tracker_deleter_new (TrackerSparqlConnection *connection,
+                                            guint batch_size,
+                                            gint priority,
+                                            GCancellable *cancellable);
+
+gboolean gom_tracker_deleter_add (GomTrackerDeleter *deleter,
+                                  const gchar *resource,
+                                  GError **error);
+
+gboolean gom_tracker_deleter_flush (GomTrackerDeleter *deleter,
+                                    GError **error);
+
+guint gom_tracker_deleter_get_n_deleted (GomTrackerDeleter *deleter);
+
+void gom_tracker_deleter_free (GomTrackerDeleter *deleter);
+
+gboolean gom_tracker_sparql_connection_delete_datasource (TrackerSparqlConnection *connection,
+                                                          GCancellable *cancellable,
+                                                          GError **error,
+                                                          const gchar *datasource_urn,
+                                                          guint batch_size,
+                                                          gint priority);
+
+gboolean gom_tracker_sparql_connection_drop_datasource (TrackerSparqlConnection *connection,
+                                                        GCancellable *cancellable,
+                                                        GError **error,
+                                                        const gchar *datasource_urn,
+                                                        gint priority);
+
 G_END_DECLS
 
 #endif /* __GOM_TRACKER_H__ */
@@ -26,11 +26,15 @@
 #include <goa/goa.h>
 #include <zpj/zpj.h>
 
+#include "gom-fetch-pool.h"
+#include "gom-trace.h"
 #include "gom-zpj-miner.h"
 #include "gom-utils.h"
 
 #define MINER_IDENTIFIER "gd:zpj:miner:30058620-777c-47a3-a19c-a6cdf4a315c4"
 
+static const gint MAX_FOLDER_LISTINGS = 4;
+
 G_DEFINE_TYPE (GomZpjMiner, gom_zpj_miner, GOM_TYPE_MINER)
 
 static gboolean
@@ -77,7 +81,7 @@ account_miner_job_process_entry (GomAccountMinerJob *job,
     goto out;
 
   gom_tracker_update_datasource (connection, datasource_urn,
-                                 resource_exists, identifier, resource,
+                                 resource_exists, resource,
                                  cancellable, error);
 
   if (*error != NULL)
@@ -86,7 +90,7 @@ account_miner_job_process_entry (GomAccountMinerJob *job,
   updated_time = zpj_skydrive_entry_get_updated_time (entry);
   new_mtime = g_date_time_to_unix (updated_time);
   mtime_changed = gom_tracker_update_mtime (connection, new_mtime,
-                                            resource_exists, identifier, resource,
+                                            resource_exists, datasource_urn, resource,
                                             cancellable, error);
 
   if (*error != NULL)
@@ -209,17 +213,38 @@ account_miner_job_process_entry (GomAccountMinerJob *job,
   return TRUE;
 }
 
+static gpointer
+list_folder_func (gpointer item,
+                  gpointer user_data,
+                  GCancellable *cancellable,
+                  GError **error)
+{
+  ZpjSkydrive *skydrive = ZPJ_SKYDRIVE (user_data);
+  const gchar *folder_id = item;
+
+  return zpj_skydrive_list_folder_id (skydrive, folder_id, cancellable, error);
+}
+
 static void
-account_miner_job_traverse_folder (GomAccountMinerJob *job,
-                                   TrackerSparqlConnection *connection,
-                                   GHashTable *previous_resources,
-                                   const gchar *datasource_urn,
-                                   const gchar *folder_id,
-                                   GCancellable *cancellable,
-                                   GError **error)
+free_entries (gpointer data)
 {
-  GList *entries = NULL, *l;
+  g_list_free_full (data, g_object_unref);
+}
+
+static void
+query_zpj (GomAccountMinerJob *job,
+           TrackerSparqlConnection *connection,
+           GHashTable *previous_resources,
+           const gchar *datasource_urn,
+           GCancellable *cancellable,
+           GError **error)
+{
+  GomFetchPool *pool;
+  GError *local_error = NULL;
+  GList *entries, *l;
   ZpjSkydrive *skydrive;
+  gboolean listing_failed = FALSE;
+  gchar *folder_id;
 
   skydrive = ZPJ_SKYDRIVE (g_hash_table_lookup (job->services, "documents"));
   if (skydrive == NULL)
@@ -229,62 +254,71 @@ account_miner_job_traverse_folder (GomAccountMinerJob *job,
                    g_quark_from_static_string ("gom-error"),
                    0,
                    "Can not query without a service");
-      goto out;
+      return;
     }
 
-  entries = zpj_skydrive_list_folder_id (skydrive,
-                                         folder_id,
-                                         cancellable,
-                                         error);
-
-  if (*error != NULL)
-    goto out;
+  /* walk the tree breadth-first: folders are listed concurrently by the
+   * pool, while the entries are written to tracker from this thread only,
+   * in the order in which the listings complete.
+   */
+  pool = gom_fetch_pool_new (MAX_FOLDER_LISTINGS,
+                             list_folder_func, skydrive,
+                             g_free, free_entries,
+                             cancellable);
+  gom_fetch_pool_push (pool, g_strdup (ZPJ_SKYDRIVE_FOLDER_SKYDRIVE));
 
-  for (l = entries; l != NULL; l = l->next)
+  while (gom_fetch_pool_pop (pool, (gpointer *) &folder_id, (gpointer *) &entries, &local_error))
     {
-      ZpjSkydriveEntry *entry = (ZpjSkydriveEntry *) l->data;
-      const gchar *id;
-
-      id = zpj_skydrive_entry_get_id (entry);
-
-      if (ZPJ_IS_SKYDRIVE_FOLDER (entry))
+      if (local_error != NULL)
         {
-          account_miner_job_traverse_folder (job, connection, previous_resources, datasource_urn, id, cancellable, error);
-          if (*error != NULL)
-            goto out;
+          /* without the root listing there is nothing to index */
+          if (g_strcmp0 (folder_id, ZPJ_SKYDRIVE_FOLDER_SKYDRIVE) == 0
+              || g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            {
+              g_propagate_error (error, local_error);
+              g_free (folder_id);
+              break;
+            }
+
+          g_warning ("Unable to list folder %s: %s", folder_id, local_error->message);
+          g_clear_error (&local_error);
+          g_free (folder_id);
+          listing_failed = TRUE;
+          continue;
         }
-      else if (ZPJ_IS_SKYDRIVE_PHOTO (entry))
-        continue;
-
-      account_miner_job_process_entry (job, connection, previous_resources, datasource_urn, entry, cancellable, error);
 
-      if (*error != NULL)
+      for (l = entries; l != NULL; l = l->next)
         {
-          g_warning ("Unable to process entry %p: %s", l->data, (*error)->message);
-          g_clear_error (error);
+          ZpjSkydriveEntry *entry = (ZpjSkydriveEntry *) l->data;
+          gint64 trace;
+
+          if (ZPJ_IS_SKYDRIVE_FOLDER (entry))
+            gom_fetch_pool_push (pool, g_strdup (zpj_skydrive_entry_get_id (entry)));
+          else if (ZPJ_IS_SKYDRIVE_PHOTO (entry))
+            continue;
+
+          trace = gom_trace_begin ();
+          account_miner_job_process_entry (job, connection, previous_resources, datasource_urn, entry, cancellable, &local_error);
+          gom_trace_end (trace, "entry", "entry");
+
+          if (local_error != NULL)
+            {
+              g_warning ("Unable to process entry %p: %s", l->data, local_error->message);
+              g_clear_error (&local_error);
+            }
         }
+
+      free_entries (entries);
+      g_free (folder_id);
     }
 
- out:
-  if (entries != NULL)
-    g_list_free_full (entries, g_object_unref);
-}
+  gom_fetch_pool_free (pool);
 
-static void
-query_zpj (GomAccountMinerJob *job,
-           TrackerSparqlConnection *connection,
-           GHashTable *previous_resources,
-           const gchar *datasource_urn,
-           GCancellable *cancellable,
-           GError **error)
-{
-  account_miner_job_traverse_folder (job,
-                                     connection,
-                                     previous_resources,
-                                     datasource_urn,
-                                     ZPJ_SKYDRIVE_FOLDER_SKYDRIVE,
-                                     cancellable,
-                                     error);
+  /* the contents of a folder we could not list are unknown, rather than
+   * gone; don't let the job delete them as if they had vanished.
+   */
+  if (listing_failed)
+    g_hash_table_remove_all (previous_resources);
 }
 
 static GHashTable *
@@ -317,6 +351,12 @@ gom_zpj_miner_init (GomZpjMiner *self)
 
 }
 
+/* 2: contacts are kept in the graph of their account */
+static const GomMinerMigration migrations[] = {
+  { 2, GOM_MINER_MIGRATION_CONTACTS_INTO_GRAPH, TRUE },
+  { 0, }
+};
+
 static void
 gom_zpj_miner_class_init (GomZpjMinerClass *klass)
 {
@@ -324,7 +364,8 @@ gom_zpj_miner_class_init (GomZpjMinerClass *klass)
 
   miner_class->goa_provider_type = "windows_live";
   miner_class->miner_identifier = MINER_IDENTIFIER;
-  miner_class->version = 1;
+  miner_class->version = 2;
+  miner_class->migrations = migrations;
 
   miner_class->create_services = create_services;
   miner_class->query = query_zpj;
@@ -140,6 +140,17 @@ tracker_ioprio_init (void)
 	}
 }
 
+/* Goes back to the default of a thread with a nice value of 0. Leaving
+ * the idle class does not need any privilege.
+ */
+void
+tracker_ioprio_normal (void)
+{
+	if (set_io_priority_best_effort (4) == -1) {
+		g_message ("Could not set best effort IO priority");
+	}
+}
+
 #else  /* __linux__ */
 
 void
@@ -147,4 +158,9 @@ tracker_ioprio_init (void)
 {
 }
 
+void
+tracker_ioprio_normal (void)
+{
+}
+
 #endif /* __linux__ */
@@ -26,6 +26,7 @@
 G_BEGIN_DECLS
 
 void tracker_ioprio_init (void);
+void tracker_ioprio_normal (void);
 
 G_END_DECLS
 
@@ -40,8 +40,10 @@ tracker_sched_idle (void)
 	 * the most important applications - like the phone
 	 * application which has a real time requirement here. This
 	 * is detailed in Nokia bug #95573
+	 *
+	 * On Linux this only applies to the calling thread.
 	 */
-	g_message ("Setting scheduler policy to SCHED_IDLE");
+	g_debug ("Setting scheduler policy to SCHED_IDLE");
 
 	if (sched_getparam (0, &sp) == 0) {
 		if (sched_setscheduler (0, SCHED_IDLE, &sp) != 0) {
@@ -66,6 +68,43 @@ tracker_sched_idle (void)
 	return TRUE;
 }
 
+/* Undoes tracker_sched_idle() for the calling thread. Without
+ * CAP_SYS_NICE, the kernel only allows it if RLIMIT_NICE permits the
+ * nice value of the thread, which it does not by default.
+ */
+gboolean
+tracker_sched_normal (void)
+{
+	struct sched_param sp;
+
+	g_debug ("Setting scheduler policy to SCHED_OTHER");
+
+	if (sched_getparam (0, &sp) != 0) {
+		const gchar *str = g_strerror (errno);
+
+		g_warning ("Could not get scheduler policy, %s",
+		           str ? str : "no error given");
+
+		return FALSE;
+	}
+
+	if (sched_getscheduler (0) == SCHED_OTHER)
+		return TRUE;
+
+	if (sched_setscheduler (0, SCHED_OTHER, &sp) != 0) {
+		if (errno != EPERM) {
+			const gchar *str = g_strerror (errno);
+
+			g_warning ("Could not set scheduler policy, %s",
+			           str ? str : "no error given");
+		}
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 #else /* __linux__ */
 
 #include <glib.h>
@@ -78,4 +117,10 @@ tracker_sched_idle (void)
 	return TRUE;
 }
 
+gboolean
+tracker_sched_normal (void)
+{
+	return TRUE;
+}
+
 #endif /* __linux__ */
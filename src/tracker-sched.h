@@ -25,6 +25,7 @@
 G_BEGIN_DECLS
 
 gboolean tracker_sched_idle (void);
+gboolean tracker_sched_normal (void);
 
 G_END_DECLS
 